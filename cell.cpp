@@ -1010,49 +1010,148 @@ EX int heptdistance(cell *c1, cell *c2) {
   else return heptdistance(c1->master, c2->master);
   }
 
-map<pair<cell*, cell*>, int> saved_distances;
+/** distances from a single source cell, as computed by celllister */
+struct saved_distances {
+  /** the cells, in the order of celllister, so sorted by the distance */
+  vector<cell*> lst;
+  /** dists[i] is the distance to lst[i] */
+  vector<int> dists;
+  /** the position of every cell in lst */
+  open_map<cell*, int, pointer_hash> index;
+  /** cells at distance d are at positions at_distance[d] to at_distance[d+1]-1 */
+  vector<int> at_distance;
+  /** lst contains every cell reachable from the source */
+  bool complete;
+  /** permanent sources are never evicted */
+  bool permanent;
+  /** the source cell */
+  cell *source;
+  /** neighbors on the LRU list, which contains the sources which are not permanent */
+  saved_distances *newer, *older;
+
+  int get(cell *c) {
+    auto id = index.find(c);
+    return id ? dists[*id] : DISTANCE_UNKNOWN;
+    }
+
+  /** would celllister with these parameters find nothing new? celllister always lists whole layers of the BFS,
+   *  so lst is the ball of radius dists.back(), and celllister(r, l) returns the ball of radius r, or the smallest
+   *  ball of at least l cells, whichever is smaller */
+  bool covers(int r, int l) { return complete || r <= dists.back() || isize(lst) >= l; }
+  };
+
+open_map<cell*, unique_ptr<saved_distances>, pointer_hash> distances_from;
+
+/** the ends of the LRU list */
+saved_distances *newest_distances, *oldest_distances;
 
 EX set<cell*> keep_distances_from;
 
-set<cell*> dists_computed;
+/** how many distances may be saved from sources which are not permanent */
+EX int saved_distances_budget = 1000000;
 
-int perma_distances;
+int temporary_distances;
 
-EX void compute_saved_distances(cell *c1, int max_range, int climit) {
-    
-  celllister cl(c1, max_range, climit, NULL);
+void unlink_distances(saved_distances *sd) {
+  (sd->newer ? sd->newer->older : newest_distances) = sd->older;
+  (sd->older ? sd->older->newer : oldest_distances) = sd->newer;
+  sd->newer = sd->older = nullptr;
+  }
 
-  for(int i=0; i<isize(cl.lst); i++)
-    saved_distances[make_pair(c1, cl.lst[i])] = cl.dists[i];
+void link_distances(saved_distances *sd) {
+  sd->older = newest_distances;
+  sd->newer = nullptr;
+  (newest_distances ? newest_distances->newer : oldest_distances) = sd;
+  newest_distances = sd;
+  }
+
+saved_distances *find_saved_distances(cell *c1) {
+  auto p = distances_from.find(c1);
+  if(!p) return nullptr;
+  saved_distances *sd = p->get();
+  if(!sd->permanent && sd != newest_distances) unlink_distances(sd), link_distances(sd);
+  return sd;
+  }
+
+/** evict the least recently used sources other than keep until the budget allows adding extra distances */
+void evict_saved_distances(int extra, saved_distances *keep) {
+  while(temporary_distances + extra > saved_distances_budget) {
+    saved_distances *lru = oldest_distances;
+    if(lru == keep) lru = lru->newer;
+    if(!lru) return;
+    temporary_distances -= isize(lru->lst);
+    unlink_distances(lru);
+    distances_from.erase(lru->source);
+    }
+  }
+
+saved_distances& compute_saved_distances(cell *c1, int max_range, int climit, bool permanent = false) {
+  auto sd = find_saved_distances(c1);
+  if(!sd || !sd->covers(max_range, climit)) {
+    celllister cl(c1, max_range, climit, NULL);
+    if(!sd) {
+      auto& p = distances_from[c1];
+      p = unique_ptr<saved_distances>(new saved_distances);
+      sd = p.get();
+      sd->source = c1;
+      sd->permanent = false;
+      link_distances(sd);
+      }
+    /* not covered, so cl.lst is a larger ball than sd->lst */
+    if(!sd->permanent) {
+      temporary_distances -= isize(sd->lst);
+      if(!permanent) evict_saved_distances(isize(cl.lst), sd);
+      temporary_distances += isize(cl.lst);
+      }
+    sd->complete = cl.dists.back() < max_range && isize(cl.lst) < climit;
+    sd->index.clear();
+    for(int i=0; i<isize(cl.lst); i++) sd->index[cl.lst[i]] = i;
+    sd->at_distance.clear();
+    for(int i=0; i<isize(cl.lst); i++)
+      while(isize(sd->at_distance) <= cl.dists[i]) sd->at_distance.push_back(i);
+    sd->at_distance.push_back(isize(cl.lst));
+    swap(sd->lst, cl.lst);
+    swap(sd->dists, cl.dists);
+    }
+  if(permanent && !sd->permanent) {
+    sd->permanent = true;
+    temporary_distances -= isize(sd->lst);
+    unlink_distances(sd);
+    }
+  return *sd;
   }
 
 EX void permanent_long_distances(cell *c1) {
   keep_distances_from.insert(c1);
   if(racing::on)
-    compute_saved_distances(c1, 300, 1000000);
+    compute_saved_distances(c1, 300, 1000000, true);
   else
-    compute_saved_distances(c1, 120, 200000);
+    compute_saved_distances(c1, 120, 200000, true);
   }
 
 EX void erase_saved_distances() {
-  saved_distances.clear(); dists_computed.clear();
-  
-  for(auto c: keep_distances_from) compute_saved_distances(c, 120, 200000);
-  perma_distances = isize(saved_distances);
+  while(oldest_distances) {
+    saved_distances *sd = oldest_distances;
+    unlink_distances(sd);
+    distances_from.erase(sd->source);
+    }
+  temporary_distances = 0;
   }
 
 EX int max_saved_distance(cell *c) {
-  int maxsd = 0;
-  for(auto& p: saved_distances) if(p.first.first == c) maxsd = max(maxsd, p.second);
-  return maxsd;
+  auto sd = find_saved_distances(c);
+  if(!sd || sd->dists.empty()) return 0;
+  return sd->dists.back();
   }
 
 EX cell *random_in_distance(cell *c, int d) {
-  vector<cell*> choices;
-  for(auto& p: saved_distances) if(p.first.first == c && p.second == d) choices.push_back(p.first.second);
-  println(hlog, "choices = ", isize(choices));
-  if(choices.empty()) return NULL;
-  return choices[hrand(isize(choices))];
+  auto sd = find_saved_distances(c);
+  int from = 0, to = 0;
+  if(sd && d >= 0 && d+1 < isize(sd->at_distance))
+    from = sd->at_distance[d], to = sd->at_distance[d+1];
+  println(hlog, "choices = ", to - from);
+  if(from == to) return NULL;
+  return sd->lst[from + hrand(to - from)];
   }
 
 EX int bounded_celldistance(cell *c1, cell *c2) {
@@ -1063,34 +1162,23 @@ EX int bounded_celldistance(cell *c1, cell *c2) {
     limit = 100000000;
     }
 
-  if(saved_distances.count(make_pair(c1,c2)))
-    return saved_distances[make_pair(c1,c2)];
-
-  celllister cl(c1, 100, limit, NULL);
-  for(int i=0; i<isize(cl.lst); i++)
-    saved_distances[make_pair(c1, cl.lst[i])] = cl.dists[i];
-
-  if(saved_distances.count(make_pair(c1,c2)))
-    return saved_distances[make_pair(c1,c2)];
+  auto sd = find_saved_distances(c1);
+  if(sd) {
+    int d = sd->get(c2);
+    if(d != DISTANCE_UNKNOWN) return d;
+    }
 
-  return DISTANCE_UNKNOWN;
+  return compute_saved_distances(c1, 100, limit).get(c2);
   }
 
 EX int clueless_celldistance(cell *c1, cell *c2) {
-  if(saved_distances.count(make_pair(c1,c2)))
-    return saved_distances[make_pair(c1,c2)];
-  
-  if(dists_computed.count(c1)) return DISTANCE_UNKNOWN;
-    
-  if(isize(saved_distances) > perma_distances + 1000000) erase_saved_distances();
-  compute_saved_distances(c1, 64, 1000);
-  
- dists_computed.insert(c1);
+  auto sd = find_saved_distances(c1);
+  if(sd) {
+    int d = sd->get(c2);
+    if(d != DISTANCE_UNKNOWN) return d;
+    }
 
-  if(saved_distances.count(make_pair(c1,c2)))
-    return saved_distances[make_pair(c1,c2)];
-    
-  return DISTANCE_UNKNOWN;
+  return compute_saved_distances(c1, 64, 1000).get(c2);
   }
 
 EX int celldistance(cell *c1, cell *c2) {
@@ -1202,10 +1290,13 @@ EX void clearCellMemory() {
       delete allmaps[i];
   allmaps.clear();
   currentmap = nullptr;
+  arena_of<cell>().release();
+  arena_of<heptagon>().release();
   last_cleared = NULL;
-  saved_distances.clear();
-  dists_computed.clear();
-  keep_distances_from.clear(); perma_distances = 0;
+  distances_from.clear();
+  newest_distances = oldest_distances = nullptr;
+  temporary_distances = 0;
+  keep_distances_from.clear();
   pd_from = NULL;
   gp::gp_adj.clear();
   }
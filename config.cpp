@@ -386,6 +386,7 @@ EX void initConfig() {
   addsaver(rug::texturesize, "rug-texturesize");
 #if CAP_RUG
   addsaver(rug::model_distance, "rug-model-distance");
+  addsaver(rug::physics_threads, "rug-physics-threads", 0);
 #endif
 
   addsaverenum(pmodel, "used model", mdDisk);
@@ -545,6 +546,7 @@ EX void initConfig() {
   addsaver(shot::gamma, "shotgamma");
   addsaver(shot::caption, "shotcaption");
   addsaver(shot::fade, "shotfade");
+  addsaver(shot::async_buffers, "shot-async-buffers", 0);
   #endif
 
 #if CAP_TEXTURE  
@@ -557,6 +559,7 @@ EX void initConfig() {
   addsaver(vid.smart_area_based, "smart-area-based", false);
   addsaver(vid.cells_drawn_limit, "limit on cells drawn", 10000);
   addsaver(vid.cells_generated_limit, "limit on cells generated", 250);
+  addsaver(number_of_threads, "threads", 1);
   
   #if CAP_SOLV
   addsaver(sn::solrange_xy, "solrange-xy");
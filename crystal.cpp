@@ -463,15 +463,23 @@ shifttable get_canonical(coord co) {
 
 EX int crystal_period = 0;
 
+struct coord_hash {
+  size_t operator() (const coord& c) const {
+    unsigned long long h = 0;
+    for(int i=0; i<MAXDIM; i++) h = (h + unsigned(c[i])) * 0x100000001B3ull;
+    return mix_hash(h);
+    }
+  };
+
 struct hrmap_crystal : hrmap_standard {
   heptagon *getOrigin() override { return get_heptagon_at(c0, S7); }
 
-  map<heptagon*, coord> hcoords;
-  map<coord, heptagon*> heptagon_at;
+  open_map<heptagon*, coord, pointer_hash> hcoords;
+  open_map<coord, heptagon*, coord_hash> heptagon_at;
   map<int, eLand> landmemo;
   map<coord, eLand> landmemo4;
-  unordered_map<cell*, unordered_map<cell*, int>> distmemo;
-  map<cell*, ldcoord> sgc;
+  open_map<cell*, open_map<cell*, int, pointer_hash>, pointer_hash> distmemo;
+  open_map<cell*, ldcoord, pointer_hash> sgc;
   cell *camelot_center;
   ldcoord camelot_coord;
   ld camelot_mul;
@@ -503,9 +511,8 @@ struct hrmap_crystal : hrmap_standard {
     }
   
   heptagon *get_heptagon_at(coord c, int deg) {
-    if(heptagon_at.count(c)) return heptagon_at[c];
-    heptagon*& h = heptagon_at[c];
-    h = tailored_alloc<heptagon> (deg);
+    if(auto p = heptagon_at.find(c)) return *p;
+    heptagon *h = tailored_alloc<heptagon> (deg);
     h->alt = NULL;
     h->cdata = NULL;
     h->c7 = newCell(deg, h);
@@ -523,32 +530,29 @@ struct hrmap_crystal : hrmap_standard {
       h->fiftyval = fiftyrule(c);    
     for(int i=0; i<cs.dim; i++) h->distance += abs(c[i]);
     h->distance /= 2;
+    heptagon_at[c] = h;
     hcoords[h] = c;
     // for(int i=0; i<6; i++) crystalstep(h, i);
     return h;
     }
   
   ldcoord get_coord(cell *c) {
-    // in C++14?
-    // auto b = sgc.emplace(c, ldc0);
-    // ldcoord& res = b.first->second;
-    if(sgc.count(c)) return sgc[c];
-    ldcoord& res = (sgc[c] = ldc0);
-    { // if(b.second) {
-      if(BITRUNCATED && c->master->c7 != c) {
-        for(int i=0; i<c->type; i+=2)
-          res = res + told(hcoords[c->cmove(i)->master]);
-        res = res * 2 / c->type;
-        }
-      else if(GOLDBERG && c->master->c7 != c) {
-        auto m = gp::get_masters(c);
-        auto H = gp::get_master_coordinates(c);
-        for(int i=0; i<cs.dim; i++)
-          res = res + told(hcoords[m[i]]) * H[i];
-        }
-      else
-        res = told(hcoords[c->master]);
+    if(auto p = sgc.find(c)) return *p;
+    ldcoord res = ldc0;
+    if(BITRUNCATED && c->master->c7 != c) {
+      for(int i=0; i<c->type; i+=2)
+        res = res + told(hcoords[c->cmove(i)->master]);
+      res = res * 2 / c->type;
       }
+    else if(GOLDBERG && c->master->c7 != c) {
+      auto m = gp::get_masters(c);
+      auto H = gp::get_master_coordinates(c);
+      for(int i=0; i<cs.dim; i++)
+        res = res + told(hcoords[m[i]]) * H[i];
+      }
+    else
+      res = told(hcoords[c->master]);
+    sgc[c] = res;
     return res;
     }
   
@@ -568,11 +572,12 @@ struct hrmap_crystal : hrmap_standard {
     }
 
   heptagon *create_step(heptagon *h, int d) override {
-    if(!hcoords.count(h)) {
+    auto p = hcoords.find(h);
+    if(!p) {
       printf("not found\n");
       return NULL;
       }
-    auto co = hcoords[h];
+    auto co = *p;
     
     #if MAXMDIM >= 4
     if(crystal3()) {
@@ -902,13 +907,16 @@ EX int precise_distance(cell *c1, cell *c2) {
   auto& distmemo = m->distmemo;
   
   if(c2 == currentmap->gamestart()) swap(c1, c2);
-  else if(isize(distmemo[c2]) > isize(distmemo[c1])) swap(c1, c2);
+  else {
+    int s2 = isize(distmemo[c2]);
+    if(s2 > isize(distmemo[c1])) swap(c1, c2);
+    }
 
-  if(distmemo[c1].count(c2)) return distmemo[c1][c2];
+  if(auto p = distmemo[c1].find(c2)) return *p;
   
   int zmin = 999999, zmax = -99;
-  forCellEx(c3, c2) if(distmemo[c1].count(c3)) {
-     int d = distmemo[c1][c3];
+  forCellEx(c3, c2) if(auto p = distmemo[c1].find(c3)) {
+     int d = *p;
      if(d < zmin) zmin = d;
      if(d > zmax) zmax = d;
      }
@@ -935,7 +943,9 @@ EX int precise_distance(cell *c1, cell *c2) {
     cell *c = cl.lst[i];
     forCellCM(c3, c) if(!cl.listed(c3)) {
       if(c3 == c1) { 
-        return distmemo[c1][c2] = distmemo[c2][c1] = 1 + steps;
+        distmemo[c1][c2] = 1 + steps;
+        distmemo[c2][c1] = 1 + steps;
+        return 1 + steps;
         }
 
       auto h = m->get_coord(c3) - co1;
@@ -1349,6 +1359,18 @@ void unit_test_tables() {
   test_crt();
   }
 
+/** generate qty cells around the origin, in BFS order, and report the time */
+void test_generation(int qty) {
+  start_game();
+  int t0 = SDL_GetTicks();
+  manual_celllister cl;
+  cl.add(currentmap->gamestart());
+  for(int i=0; i<isize(cl.lst) && isize(cl.lst) < qty; i++)
+    forCellCM(c1, cl.lst[i]) cl.add(c1);
+  int t1 = SDL_GetTicks();
+  println(hlog, "generated ", isize(cl.lst), " cells in ", get_dim(), "D crystal: ", t1-t0, " ms");
+  }
+
 EX void set_crystal_period_flags() {
   crystal_period &= ~1;
   for(auto& g: ginf)
@@ -1393,6 +1415,9 @@ int readArgs() {
   else if(argis("-test:crt")) {
     test_crt();
     }
+  else if(argis("-test:crystal-gen")) {
+    PHASE(3); shift(); test_generation(argi());
+    }
   else if(argis("-crystal_period")) {
     if(cryst) stop_game();
     shift(); crystal_period = argi();
@@ -410,7 +410,7 @@ struct debugScreen {
         dialog::addSelItem("cpdist", its(what->cpdist), 0);
         dialog::addSelItem("celldist", its(celldist(what)), 0);
         dialog::addSelItem("celldistance", its(celldistance(cwt.at, what)), 0);
-        dialog::addSelItem("pathdist", its(what->pathdist), 0);
+        dialog::addSelItem("pathdist", its(graphical_search.dist(what)), 0);
         dialog::addSelItem("celldistAlt", eubinary ? its(celldistAlt(what)) : "--", 0);
         dialog::addSelItem("temporary", its(what->listindex), 0);
         #if CAP_GP
@@ -610,6 +610,131 @@ void test_distances(int max) {
   println(hlog, "ok=", ok, " bad=", bad);
   }
 
+/** compare shmup::monstersAt with the multimap it used to be, on a simulated workload:
+ *  in every turn, the monsters close to cwt.at are activated and stored again, and then
+ *  all the cells are queried, as when drawing */
+void test_monster_storage(int qty, int turns) {
+  celllister cl(cwt.at, 8, 100000, NULL);
+  vector<shmup::monster> ms(qty);
+  vector<pair<cell*, shmup::monster*>> start;
+  for(auto& m: ms) start.emplace_back(cl.lst[hrand(isize(cl.lst))], &m);
+
+  multimap<cell*, shmup::monster*> mm;
+  shmup::monster_storage ms2;
+  for(auto& p: start) mm.insert(p), ms2.insert(p);
+
+  vector<pair<cell*, shmup::monster*>> moved;
+  size_t sum1 = 0, sum2 = 0;
+
+  int t0 = SDL_GetTicks();
+  for(int t=0; t<turns; t++) {
+    moved.clear();
+    for(cell *c: cl.lst) if(cl.getdist(c) <= 4) {
+      auto p = mm.equal_range(c);
+      for(auto it = p.first; it != p.second; it++) moved.emplace_back(c->cmove(t % c->type), it->second);
+      mm.erase(p.first, p.second);
+      }
+    for(auto& p: moved) mm.insert(p);
+    for(cell *c: cl.lst) {
+      auto p = mm.equal_range(c);
+      for(auto it = p.first; it != p.second; it++) sum1 += reinterpret_cast<size_t>(it->second);
+      }
+    }
+  int t1 = SDL_GetTicks();
+  for(int t=0; t<turns; t++) {
+    moved.clear();
+    for(cell *c: cl.lst) if(cl.getdist(c) <= 4) {
+      auto p = ms2.equal_range(c);
+      for(auto it = p.first; it != p.second; it++) moved.emplace_back(c->cmove(t % c->type), it->second);
+      ms2.erase(c);
+      }
+    for(auto& p: moved) ms2.insert(p);
+    ms2.rebuild();
+    for(cell *c: cl.lst) {
+      auto p = ms2.equal_range(c);
+      for(auto it = p.first; it != p.second; it++) sum2 += reinterpret_cast<size_t>(it->second);
+      }
+    }
+  int t2 = SDL_GetTicks();
+
+  println(hlog, "monsters: ", qty, " cells: ", isize(cl.lst), " turns: ", turns);
+  println(hlog, "multimap: ", t1-t0, " ms, flat storage: ", t2-t1, " ms", sum1 == sum2 ? "" : " (results differ!)");
+  }
+
+/** compare the matrix products (SIMD if available) and apply_to_points against the scalar loops, in the current MDIM */
+void test_matrix_kernels_dim(int qty, int reps) {
+  vector<transmatrix> T(qty), U(qty), R1(qty), R2(qty);
+  vector<hyperpoint> H(qty), P1(qty), P2(qty), P3(qty);
+  for(int i=0; i<qty; i++) for(int a=0; a<MAXMDIM; a++) {
+    H[i][a] = hrandf() - .5;
+    for(int b=0; b<MAXMDIM; b++) T[i][a][b] = hrandf() - .5, U[i][a][b] = hrandf() - .5;
+    }
+
+  auto scalar_mm = [] (const transmatrix& A, const transmatrix& B, transmatrix& C) {
+    for(int i=0; i<MDIM; i++) for(int j=0; j<MDIM; j++) {
+      C[i][j] = 0;
+      for(int k=0; k<MDIM; k++) C[i][j] += A[i][k] * B[k][j];
+      }
+    };
+  auto scalar_mv = [] (const transmatrix& A, const hyperpoint& h, hyperpoint& z) {
+    for(int i=0; i<MDIM; i++) {
+      z[i] = 0;
+      for(int j=0; j<MDIM; j++) z[i] += A[i][j] * h[j];
+      }
+    };
+
+  int t0 = SDL_GetTicks();
+  for(int r=0; r<reps; r++) for(int i=0; i<qty; i++) scalar_mm(T[i], U[(i+r)%qty], R1[i]);
+  int t1 = SDL_GetTicks();
+  for(int r=0; r<reps; r++) for(int i=0; i<qty; i++) R2[i] = T[i] * U[(i+r)%qty];
+  int t2 = SDL_GetTicks();
+  for(int r=0; r<reps; r++) for(int i=0; i<qty; i++) scalar_mv(T[r%qty], H[i], P1[i]);
+  int t3 = SDL_GetTicks();
+  for(int r=0; r<reps; r++) for(int i=0; i<qty; i++) P2[i] = T[r%qty] * H[i];
+  int t4 = SDL_GetTicks();
+  for(int r=0; r<reps; r++) apply_to_points(T[r%qty], &H[0], &P3[0], qty);
+  int t5 = SDL_GetTicks();
+
+  /* the compiler may fuse multiplications and additions differently in the scalar loops and in the kernels
+   * (e.g. GCC with -ffp-contract=fast on a target with FMA), so the results may differ in the last bits */
+  int diff = 0, exact = 0;
+  auto cmp = [&] (ld x, ld y) { if(x != y) exact++; if(abs(x - y) > 1e-12) diff++; };
+  for(int i=0; i<qty; i++) for(int a=0; a<MDIM; a++) {
+    cmp(P1[i][a], P2[i][a]); cmp(P1[i][a], P3[i][a]);
+    for(int b=0; b<MDIM; b++) cmp(R1[i][a][b], R2[i][a][b]);
+    }
+
+  println(hlog, "MDIM = ", MDIM, " SIMD = ", CAP_SIMD, " products: ", qty, "x", reps);
+  println(hlog, "matrix*matrix: scalar ", t1-t0, " ms, operator ", t2-t1, " ms");
+  println(hlog, "matrix*point: scalar ", t3-t2, " ms, operator ", t4-t3, " ms, apply_to_points ", t5-t4, " ms");
+  if(diff) println(hlog, "results differ: ", diff);
+  else if(exact) println(hlog, "results agree up to rounding, not bit-identical: ", exact);
+  else println(hlog, "results identical");
+  }
+
+void test_matrix_kernels(int qty, int reps) {
+  /* only MDIM is needed, so we do not have to start the game in these geometries */
+  for(eGeometry g: {gNormal, gCubeTiling}) {
+    dynamicval<eGeometry> dg(geometry, g);
+    test_matrix_kernels_dim(qty, reps);
+    }
+  }
+
+/** report how many points per second inverse_exp handles, on qty random points in the table range */
+void test_inverse_exp(int qty, flagtype prec) {
+  vector<hyperpoint> h(qty), r(qty);
+  #if CAP_SOLV
+  ld rxy = sn::in() ? sn::solrange_xy : 5, rz = sn::in() ? sn::solrange_z : 5;
+  #else
+  ld rxy = 5, rz = 5;
+  #endif
+  for(auto& p: h) p = point31((2*hrandf()-1) * rxy, (2*hrandf()-1) * rxy, (2*hrandf()-1) * rz);
+  int t0 = SDL_GetTicks();
+  for(int i=0; i<qty; i++) r[i] = inverse_exp(shiftless(h[i]), prec);
+  int t1 = SDL_GetTicks();
+  println(hlog, "inverse_exp: ", t1-t0, " ms (", t1 > t0 ? its(int(qty * 1000. / (t1-t0))) : string("-"), " points/s)");
+  }
+
 EX void raiseBuggyGeneration(cell *c, const char *s) {
 
   printf("procgen error (%p): %s\n", hr::voidp(c), s);
@@ -730,6 +855,21 @@ int read_cheat_args() {
   else if(argis("-testdistances")) {
     PHASE(3); shift(); test_distances(argi());
     }
+  else if(argis("-test-shmup-storage")) {
+    PHASE(3); start_game();
+    shift(); int qty = argi();
+    shift(); test_monster_storage(qty, argi());
+    }
+  else if(argis("-test-matrix")) {
+    PHASE(3); start_game();
+    shift(); int qty = argi();
+    shift(); test_matrix_kernels(qty, argi());
+    }
+  else if(argis("-test-inverse-exp")) {
+    PHASE(3); start_game();
+    shift(); int qty = argi();
+    shift(); test_inverse_exp(qty, argi());
+    }
   else if(argis("-M")) {
     PHASE(3) cheat(); start_game(); if(WDIM == 3) { drawthemap(); bfs(); }
     shift(); eMonster m = readMonster(args());
@@ -23,7 +23,6 @@
 
 #include "../hyper.h"
 
-#include <thread>
 #include <mutex>
 
 namespace hr {
@@ -33,12 +32,9 @@ transmatrix parabolic1(ld u);
 namespace sn {
 
 template<class T> void parallelize(int threads, int Nmin, int Nmax, T action) {
-  std::vector<std::thread> v;
-  for(int k=0; k<threads; k++)
-    v.emplace_back([&,k] () { 
-      for(int i=Nmin+k; i < Nmax; i += threads) action(k, i);
-      });
-  for(std::thread& t:v) t.join();
+  parallel_chunks(threads, [&] (int k) {
+    for(int i=Nmin+k; i < Nmax; i += threads) action(k, i);
+    });
   }
 
 ld solerror(hyperpoint ok, hyperpoint chk) {
@@ -145,23 +141,12 @@ ptlow operator +(ptlow a, ptlow b) { return make_array<float>(a[0]+b[0], a[1]+b[
 ptlow operator -(ptlow a, ptlow b) { return make_array<float>(a[0]-b[0], a[1]-b[1], a[2]-b[2]); }
 ptlow operator *(ptlow a, ld x) { return make_array<float>(a[0]*x, a[1]*x, a[2]*x); }
 
-void fint(FILE *f, int x) { fwrite(&x, sizeof(x), 1, f); }
-void ffloat(FILE *f, float x) { fwrite(&x, sizeof(x), 1, f); }
-
 void write_table(sn::tabled_inverses& tab, const char *fname) {
-  FILE *f = fopen(fname, "wb");
-  fint(f, tab.PRECX);
-  fint(f, tab.PRECY);
-  fint(f, tab.PRECZ);
-  fwrite(&tab.tab[0], sizeof(ptlow) * tab.PRECX * tab.PRECY * tab.PRECZ, 1, f);
-  fclose(f);
+  tab.save(fname);
   }
 
 void alloc_table(sn::tabled_inverses& tab, int X, int Y, int Z) {
-  tab.PRECX = X;
-  tab.PRECY = Y;
-  tab.PRECZ = Z;
-  tab.tab.resize(X*Y*Z);
+  tab.allocate(X, Y, Z);
   }
 
 ld ptd(ptlow p) {
@@ -39,6 +39,9 @@ static const int POLY_FAT = (1<<26);            // fatten this model in WRL expo
 static const int POLY_SHADE_TEXTURE = (1<<27);  // texture has 'z' coordinate for shading
 static const int POLY_ONE_LEVEL = (1<<28);      // only one level of the universal cover in SL(2,R)
 
+void* dqi_alloc(size_t s);
+void dqi_free(void *p, size_t s);
+
 /** \brief A graphical element that can be drawn. Objects are not drawn immediately but rather queued.
  *
  *  HyperRogue map rendering functions do not draw its data immediately; instead, they call the 'queue' functions
@@ -59,6 +62,9 @@ struct drawqueueitem {
   virtual ~drawqueueitem() {}
   /** \brief When minimizing OpenGL calls, we need to group items of the same color, etc. together. This value is used as an extra sorting key. */
   virtual color_t outline_group() = 0;
+  /** \brief Drawqueueitems are allocated from hr::dqi_pool, see dqi_alloc. */
+  static void* operator new(size_t s) { return dqi_alloc(s); }
+  static void operator delete(void *p, size_t s) { dqi_free(p, s); }
   };
 
 /** \brief Drawqueueitem used to draw polygons. The majority of drawqueueitems fall here. */
@@ -167,6 +173,40 @@ EX color_t poly_outline;
 
 EX vector<unique_ptr<drawqueueitem>> ptds;
 
+/** \brief size classes of dqi_pool, in multiples of 16 bytes */
+static const int DQI_CLASSES = 64;
+
+/** \brief Memory of the drawqueueitems which have been freed.
+ *
+ *  Tens of thousands of drawqueueitems are queued and freed in every frame. Their memory is
+ *  not returned to the heap, but kept here (by size rounded up to 16 bytes), and reused in the next frame.
+ *  New memory is obtained in chunks of DQI_CHUNK items, so the items of a frame are mostly contiguous.
+ *  Not thread-safe: the drawing queue is only used from the main thread.
+ *  Never destroyed, since drawqueueitems may still be freed by the destructors of other global objects.
+ */
+vector<void*> *dqi_pool = new vector<void*>[DQI_CLASSES];
+
+static const int DQI_CHUNK = 256;
+
+void* dqi_alloc(size_t s) {
+  size_t c = (s + 15) >> 4;
+  if(c >= DQI_CLASSES) return ::operator new(s);
+  auto& pool = dqi_pool[c];
+  if(pool.empty()) {
+    char *chunk = (char*) ::operator new(DQI_CHUNK * (c << 4));
+    for(int i=DQI_CHUNK-1; i>=0; i--) pool.push_back(chunk + i * (c << 4));
+    }
+  void *res = pool.back();
+  pool.pop_back();
+  return res;
+  }
+
+void dqi_free(void *p, size_t s) {
+  size_t c = (s + 15) >> 4;
+  if(c >= DQI_CLASSES) ::operator delete(p);
+  else dqi_pool[c].push_back(p);
+  }
+
 #if CAP_GL
 EX color_t text_color;
 EX int text_shift;
@@ -418,43 +458,56 @@ bool behind3(shiftpoint h) {
   return h[2] < 0;
   }
 
+/** the vertices of the polygon being drawn, after applying V.T */
+vector<hyperpoint> transformed;
+
+/** transform the vertices tab[ofs..ofs+cnt) in one pass, rather than one matrix product per vertex */
+void transform_vertices(const transmatrix& T, const vector<glvertex> &tab, int ofs, int cnt, bool affine = false) {
+  transformed.resize(cnt);
+  for(int i=0; i<cnt; i++) {
+    transformed[i] = glhr::gltopoint(tab[ofs+i]);
+    if(affine) transformed[i][3] = 1;
+    }
+  if(cnt) apply_to_points(T, &transformed[0], &transformed[0], cnt);
+  }
+
 void addpoly(const shiftmatrix& V, const vector<glvertex> &tab, int ofs, int cnt) {
+  /* transformed has exactly cnt entries, and the code below reads transformed[0] */
+  if(cnt == 0) return;
   if(pmodel == mdPixel) {
-    for(int i=ofs; i<ofs+cnt; i++) {
-      hyperpoint h = glhr::gltopoint(tab[i]);
-      h[3] = 1;
-      h = V.T * h;
-      add1(h);
-      }
+    transform_vertices(V.T, tab, ofs, cnt, true);
+    for(int i=0; i<cnt; i++) add1(transformed[i]);
     return;
     }
+  transform_vertices(V.T, tab, ofs, cnt);
+  auto at = [&] (int i) { return shiftpoint{transformed[i], V.shift}; };
   tofix.clear(); knowgood = false;
   if(among(pmodel, mdPerspective, mdGeodesic)) {
     if(poly_flags & POLY_TRIANGLES) {
-      for(int i=ofs; i<ofs+cnt; i+=3) {
-        shiftpoint h0 = V * glhr::gltopoint(tab[i]);
-        shiftpoint h1 = V * glhr::gltopoint(tab[i+1]);
-        shiftpoint h2 = V * glhr::gltopoint(tab[i+2]);
+      for(int i=0; i<cnt; i+=3) {
+        shiftpoint h0 = at(i);
+        shiftpoint h1 = at(i+1);
+        shiftpoint h2 = at(i+2);
         if(!behind3(h0) && !behind3(h1) && !behind3(h2)) 
           addpoint(h0), addpoint(h1), addpoint(h2);
         }
       }
     else {
-      for(int i=ofs; i<ofs+cnt; i++) {
-        shiftpoint h = V * glhr::gltopoint(tab[i]);
+      for(int i=0; i<cnt; i++) {
+        shiftpoint h = at(i);
         if(!behind3(h)) addpoint(h);
         }
       }
     return;
     }
-  shiftpoint last = V * glhr::gltopoint(tab[ofs]);
+  shiftpoint last = at(0);
   bool last_behind = is_behind(last.h);
   if(!last_behind) addpoint(last);
   hyperpoint enter = C0;
   hyperpoint firstleave;
   int start_behind = last_behind ? 1 : 0;
-  for(int i=ofs+1; i<ofs+cnt; i++) {
-    shiftpoint curr = V*glhr::gltopoint(tab[i]);
+  for(int i=1; i<cnt; i++) {
+    shiftpoint curr = at(i);
     if(is_behind(curr.h) != last_behind) {
       hyperpoint h = be_just_on_view(last.h, curr.h);
       if(start_behind == 1) start_behind = 2, firstleave = h;
@@ -1517,10 +1570,9 @@ void dqi_poly::draw() {
 
   if(!hyperbolic && among(pmodel, mdPolygonal, mdPolynomial)) {
     bool any = false;
-    for(int i=0; i<cnt; i++) {
-      hyperpoint h1 = V.T * glhr::gltopoint((*tab)[offset+i]);
-      if(h1[2] > 0) any = true;
-      }
+    transform_vertices(V.T, *tab, offset, cnt);
+    for(int i=0; i<cnt; i++)
+      if(transformed[i][2] > 0) any = true;
     if(!any) return;
     }
   
@@ -2002,6 +2054,62 @@ void dqi_line::draw_back() {
   draw();
   }
 
+/** \brief the key used to sort an item of the drawing queue inside its priority, see sort_drawqueue */
+struct drawqueue_key {
+  /** \brief the inner key (bits 32-63) and the outline group (bits 0-31) */
+  unsigned long long key;
+  /** \brief the index in ptds */
+  int id;
+  };
+
+/** \brief in 2D, these priorities are sorted by depth */
+bool depth_sorted(PPR p) {
+  switch(p) {
+    case PPR::REDWALLs: case PPR::REDWALLs2: case PPR::REDWALLs3: case PPR::WALL3s:
+    case PPR::LAKEWALL: case PPR::INLAKEWALL: case PPR::BELOWBOTTOM: case PPR::ASHALLOW: case PPR::BSHALLOW:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+/** \brief map x to an unsigned value, so that the order is preserved */
+unsigned order_key(float x) {
+  unsigned u;
+  memcpy(&u, &x, sizeof(u));
+  return (u >> 31) ? ~u : (u | 0x80000000u);
+  }
+
+/** \brief stable LSD radix sort of n keys, using buf as the scratch space
+ *
+ *  The histograms of all the bytes are computed in a single pass, and the bytes in which all the keys agree are skipped.
+ *  Returns the array which contains the result (either k or buf).
+ */
+drawqueue_key* radix_sort(drawqueue_key *k, drawqueue_key *buf, int n) {
+  int count[8][256];
+  memset(count, 0, sizeof(count));
+  for(int i=0; i<n; i++) {
+    auto x = k[i].key;
+    for(int b=0; b<8; b++) count[b][(x >> (8*b)) & 255]++;
+    }
+  for(int b=0; b<8; b++) {
+    auto& c = count[b];
+    if(c[(k[0].key >> (8*b)) & 255] == n) continue;
+    int total = 0;
+    for(int i=0; i<256; i++) { int x = c[i]; c[i] = total; total += x; }
+    for(int i=0; i<n; i++) buf[c[(k[i].key >> (8*b)) & 255]++] = k[i];
+    swap(k, buf);
+    }
+  return k;
+  }
+
+/** \brief sort the drawing queue
+ *
+ *  Items are sorted by priority (a counting sort), and then the priorities which need it are radix sorted by
+ *  the packed secondary key: walls by depth in 2D, transparent walls by descending subprio, and,
+ *  when minimizing GL calls, the other items by color and outline group.
+ *  The sort is stable, so items with equal keys are drawn in the order they have been queued.
+ */
 EX void sort_drawqueue() {
 
   #if MAXMDIM >= 4 && CAP_GL
@@ -2014,24 +2122,40 @@ EX void sort_drawqueue() {
   
   int siz = isize(ptds);
 
-  #if MINIMIZE_GL_CALLS
-  unordered_map<color_t, vector<unique_ptr<drawqueueitem>>> subqueue;
-  for(auto& p: ptds) subqueue[(p->prio == PPR::CIRCLE || p->prio == PPR::OUTCIRCLE) ? 0 : p->outline_group()].push_back(move(p));
-  ptds.clear();
-  for(auto& p: subqueue) for(auto& r: p.second) ptds.push_back(move(r));
-  subqueue.clear();
-  for(auto& p: ptds) subqueue[(p->prio == PPR::CIRCLE || p->prio == PPR::OUTCIRCLE) ? 0 : p->color].push_back(move(p));
-  ptds.clear();
-  for(auto& p: subqueue) for(auto& r: p.second) ptds.push_back(move(r));
-  #endif
+  static vector<drawqueue_key> keys, sorted;
+  keys.resize(siz); sorted.resize(siz);
+
+  /* or of the keys in each priority, to skip the priorities which need no sorting */
+  unsigned long long used[PMAX];
+  for(int a=0; a<PMAX; a++) used[a] = 0;
+
+  bool depth = GDIM == 2;
+  hyperpoint depth_point = depth ? xpush0(.1) : C0;
     
-  for(auto& p: ptds) {
+  for(int i=0; i<siz; i++) {
+    auto& p = ptds[i];
     int pd = p->prio - PPR::ZERO;
     if(pd < 0 || pd >= PMAX) {
       printf("Illegal priority %d\n", pd);
       p->prio = PPR(rand() % int(PPR::MAX));
+      pd = p->prio - PPR::ZERO;
       }
     qp[pd]++;
+    unsigned inner = 0, group = 0;
+    if(depth && depth_sorted(p->prio)) {
+      auto& ap = (dqi_poly&) *p;
+      ap.cache = xintval(ap.V * depth_point);
+      inner = order_key(ap.cache);
+      }
+    else if(p->prio == PPR::TRANSPARENT_WALL)
+      inner = ~(unsigned(p->subprio) ^ 0x80000000u);
+    #if MINIMIZE_GL_CALLS
+    else if(p->prio != PPR::CIRCLE && p->prio != PPR::OUTCIRCLE)
+      inner = p->color, group = p->outline_group();
+    #endif
+    keys[i].key = ((unsigned long long) inner << 32) | group;
+    keys[i].id = i;
+    used[pd] |= keys[i].key;
     }
   
   int total = 0;
@@ -2040,11 +2164,21 @@ EX void sort_drawqueue() {
     qp0[a] = qp[a] = total; total += b;
     }
 
-  vector<unique_ptr<drawqueueitem>> ptds2;  
+  for(int i = 0; i<siz; i++) sorted[qp[int(ptds[i]->prio)]++] = keys[i];
+
+  for(int a=0; a<PMAX; a++) {
+    int n = qp[a] - qp0[a];
+    if(n < 2 || !used[a]) continue;
+    auto res = radix_sort(&sorted[qp0[a]], &keys[qp0[a]], n);
+    if(res != &sorted[qp0[a]]) std::copy(res, res+n, &sorted[qp0[a]]);
+    }
+
+  static vector<unique_ptr<drawqueueitem>> ptds2;
   ptds2.resize(siz);
   
-  for(int i = 0; i<siz; i++) ptds2[qp[int(ptds[i]->prio)]++] = move(ptds[i]);
+  for(int i = 0; i<siz; i++) ptds2[i] = move(ptds[sorted[i].id]);
   swap(ptds, ptds2);
+  ptds2.clear();
   }
 
 EX void reverse_priority(PPR p) {
@@ -2212,34 +2346,6 @@ EX void drawqueue() {
   
   sort_drawqueue();
 
-  DEBB(DF_GRAPH, ("sort walls"));
-  
-  if(GDIM == 2) 
-  for(PPR p: {PPR::REDWALLs, PPR::REDWALLs2, PPR::REDWALLs3, PPR::WALL3s,
-    PPR::LAKEWALL, PPR::INLAKEWALL, PPR::BELOWBOTTOM, PPR::ASHALLOW, PPR::BSHALLOW}) {
-    int pp = int(p);
-    if(qp0[pp] == qp[pp]) continue;
-    for(int i=qp0[pp]; i<qp[pp]; i++) {
-      auto ap = (dqi_poly&) *ptds[i];
-      ap.cache = xintval(ap.V * xpush0(.1));
-      }
-    sort(&ptds[qp0[pp]], &ptds[qp[pp]], 
-      [] (const unique_ptr<drawqueueitem>& p1, const unique_ptr<drawqueueitem>& p2) {
-        auto ap1 = (dqi_poly&) *p1;
-        auto ap2 = (dqi_poly&) *p2;
-        return ap1.cache < ap2.cache;
-        });
-    }
-
-  for(PPR p: {PPR::TRANSPARENT_WALL}) {
-    int pp = int(p);
-    if(qp0[pp] == qp[pp]) continue;
-    sort(&ptds[qp0[int(p)]], &ptds[qp[int(p)]], 
-      [] (const unique_ptr<drawqueueitem>& p1, const unique_ptr<drawqueueitem>& p2) {
-        return p1->subprio > p2->subprio;
-        });
-    }
-
   profile_stop(3);
 
 #if CAP_SDL
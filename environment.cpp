@@ -53,20 +53,18 @@ EX vector<cell*> worms, ivies, ghosts, golems, hexsnakes;
 /** temporary changes during bfs */
 vector<pair<cell*, eMonster>> tempmonsters;
 
-/** additional direction information for BFS algorithms.
+/** additional direction information for bfs().
  *  It remembers from where we have got to this location
  *  the opposite cell will be added to the queue first,
  *  which helps the AI.
  **/
-EX vector<int> reachedfrom;
+vector<int> dcal_reachedfrom;
 
 /** The position of the first cell in dcal in distance 7. New wandering monsters can be generated in dcal[first7..]. */
 EX int first7;           
 
 /** the list of all nearby cells, according to cpdist */
 EX vector<cell*> dcal;
-/** the list of all nearby cells, according to current pathdist */
-EX vector<cell*> pathq;
 
 /** the number of big statues -- they increase monster generation */
 EX int statuecount;
@@ -74,7 +72,7 @@ EX int statuecount;
 /** the number of slimes in Wetland -- they create ghosts */
 EX int wetslime;
 
-/** list of monsters to move (pathq restriced to monsters) */
+/** list of monsters to move (path_search.q restriced to monsters) */
 EX vector<cell*> pathqm;
 
 /** which hex snakes are there */
@@ -87,49 +85,98 @@ EX int gamerange() { return getDistLimit() + gamerange_bonus; }
 EX cell *pd_from;
 EX int pd_range;
 
+#if HDR
+extern unsigned last_bfs_stamp[BFS_KINDS];
+
+/** \brief a breadth-first search with generation-stamped visited marks
+ *
+ *  Every search gets a new stamp when started. A cell has been reached by the
+ *  search iff its pathstamp[kind] equals the stamp of the search, and then its
+ *  pathdist[kind] is the distance. Thus starting a new search takes O(1) time,
+ *  instead of resetting all the cells reached by the previous one. Every kind has
+ *  its own slot in the cells, so searches of different kinds do not interfere; the
+ *  marks of a search remain valid until another search of the same kind is started
+ *  (see current()).
+ */
+struct bfs_search {
+  /** \brief which slot of pathstamp and pathdist this search uses */
+  int kind;
+  /** \brief the stamp of this search, 0 if not running */
+  unsigned stamp;
+  /** \brief the cells reached, in order */
+  vector<cell*> q;
+  /** \brief the direction from which q[i] has been reached (if the search records it) */
+  vector<int> reachedfrom;
+  explicit bfs_search(int k = 0) : kind(k), stamp(0) {}
+  void start();
+  void stop() { stamp = 0; q.clear(); reachedfrom.clear(); }
+  bool reached(cell *c) const { return stamp && c->pathstamp[kind] == stamp; }
+  int dist(cell *c) const { return reached(c) ? int(c->pathdist[kind]) : PINFD; }
+  void add(cell *c, int d) { c->pathstamp[kind] = stamp; c->pathdist[kind] = d; q.push_back(c); }
+  void add(cell *c, int d, int sp) { add(c, d); reachedfrom.push_back(sp); }
+  /** \brief false if the marks may have been overwritten by a later search of the same kind */
+  bool current() const { return stamp && stamp == last_bfs_stamp[kind]; }
+  };
+
+extern bfs_search path_search;
+
+/** \brief distance according to the current monster AI search (PINFD if not reached) */
+inline int path_distance(cell *c) { return path_search.dist(c); }
+#endif
+
+/** \brief the stamp given to the most recently started bfs_search of each kind */
+unsigned last_bfs_stamp[BFS_KINDS];
+
+void bfs_search::start() {
+  auto& last = last_bfs_stamp[kind];
+  stamp = ++last;
+  if(!stamp) stamp = ++last;
+  q.clear(); reachedfrom.clear();
+  }
+
+/** \brief the search used by the monster AI, see pathdata */
+EX bfs_search path_search = bfs_search(0);
+
+/** \brief the search used by compute_graphical_distance */
+EX bfs_search graphical_search = bfs_search(1);
+
 EX void onpath(cell *c, int d) {
-  c->pathdist = d;
-  pathq.push_back(c);
+  path_search.add(c, d);
   }
 
 EX void onpath(cell *c, int d, int sp) {
-  c->pathdist = d;
-  pathq.push_back(c);
-  reachedfrom.push_back(sp);
+  path_search.add(c, d, sp);
   }
 
 EX void clear_pathdata() {
-  for(auto c: pathq) c->pathdist = PINFD;
-  pathq.clear(); 
+  path_search.stop();
   pathqm.clear();
-  reachedfrom.clear(); 
   }
 
-EX int pathlock = 0;
-
 EX void compute_graphical_distance() {
-  if(pathlock) { printf("path error: compute_graphical_distance\n"); }
   cell *c1 = centerover ? centerover : pd_from ? pd_from : cwt.at;
   int sr = get_sightrange_ambush();
-  if(pd_from == c1 && pd_range == sr) return;
-  clear_pathdata();
+  auto& gs = graphical_search;
+  if(pd_from == c1 && pd_range == sr && gs.current()) return;
+  gs.start();
   
   pd_from = c1;
   pd_range = sr;
-  c1->pathdist = 0;
-  pathq.push_back(pd_from);
+  gs.add(c1, 0);
 
-  for(int qb=0; qb<isize(pathq); qb++) {
-    cell *c = pathq[qb];
-    if(c->pathdist == pd_range) break;
+  for(int qb=0; qb<isize(gs.q); qb++) {
+    cell *c = gs.q[qb];
+    int d = gs.dist(c);
+    if(d == pd_range) break;
     if(qb == 0) forCellCM(c1, c) ;
     forCellEx(c1, c)
-      if(c1->pathdist == PINFD)
-        onpath(c1, c->pathdist + 1);
+      if(!gs.reached(c1))
+        gs.add(c1, d + 1);
     }
   }
 
 EX void computePathdist(eMonster param) {
+  auto& ps = path_search;
   
   for(cell *c: targets)
     onpath(c, isPlayerOn(c) ? 0 : 1, hrand(c->type));
@@ -138,9 +185,9 @@ EX void computePathdist(eMonster param) {
   
   int limit = gamerange();
 
-  for(int qb=0; qb < isize(pathq); qb++) {
-    cell *c = pathq[qb];
-    int fd = reachedfrom[qb] + c->type/2;
+  for(int qb=0; qb < isize(ps.q); qb++) {
+    cell *c = ps.q[qb];
+    int fd = ps.reachedfrom[qb] + c->type/2;
     if(c->monst && !isBug(c) && !(isFriendly(c) && !c->stuntime)) {
       pathqm.push_back(c); 
       continue; // no paths going through monsters
@@ -151,14 +198,14 @@ EX void computePathdist(eMonster param) {
       continue; 
       }
     if(c->cpdist > limit && !(c->land == laTrollheim && turncount < c->landparam) && c->wall != waThumperOn) continue;
-    int d = c->pathdist;
+    int d = ps.dist(c);
     if(d == PINFD - 1) continue;
     for(int j=0; j<c->type; j++) {
       int i = (fd+j) % c->type; 
       // printf("i=%d cd=%d\n", i, c->move(i)->cpdist);
       cell *c2 = c->move(i);
 
-      if(c2 && c2->pathdist == PINFD &&
+      if(c2 && !ps.reached(c2) &&
         passable(c2, (qb<qtarg) && !nonAdjacent(c,c2) && !thruVine(c,c2) ?NULL:c, P_MONSTER | P_REVDIR)) {
         
         if(qb >= qtarg) {
@@ -176,22 +223,21 @@ EX void computePathdist(eMonster param) {
   }
 
 #if HDR
+/** \brief computes the monster AI paths (path_search) for its lifetime */
 struct pathdata {
-  void checklock() { 
-    if(pd_from) pd_from = NULL, clear_pathdata();
-    if(pathlock) printf("path error\n"); 
-    pathlock++; 
+  void start() { 
+    path_search.start();
+    pathqm.clear();
     }
   ~pathdata() {
-    pathlock--;
     clear_pathdata();
     }
   pathdata(eMonster m) { 
-    checklock();
+    start();
     computePathdist(m); 
     }
   pathdata(int i) { 
-    checklock();
+    start();
     }
   };
 #endif
@@ -224,7 +270,7 @@ EX void bfs() {
   airmap.clear();
   if(!(hadwhat & HF_ROSE)) rosemap.clear();
   
-  dcal.clear(); reachedfrom.clear(); 
+  dcal.clear(); dcal_reachedfrom.clear(); 
 
   recalcTide = false;
   
@@ -235,7 +281,7 @@ EX void bfs() {
     c->cpdist = 0;
     checkTide(c);
     dcal.push_back(c);
-    reachedfrom.push_back(hrand(c->type));
+    dcal_reachedfrom.push_back(hrand(c->type));
     if(!invismove) targets.push_back(c);
     }
   
@@ -253,7 +299,7 @@ EX void bfs() {
   first7 = 0;
   while(true) {
     if(qb == isize(dcal)) break;
-    int i, fd = reachedfrom[qb] + 3;
+    int i, fd = dcal_reachedfrom[qb] + 3;
     cell *c = dcal[qb++];
     
     int d = c->cpdist;
@@ -334,7 +380,7 @@ EX void bfs() {
         
         if(!keepLightning) c2->ligon = 0;
         dcal.push_back(c2);
-        reachedfrom.push_back(c->c.spin(i));
+        dcal_reachedfrom.push_back(c->c.spin(i));
         
         checkTide(c2);
                 
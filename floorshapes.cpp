@@ -26,6 +26,9 @@ EX vector<basic_textureinfo> floor_texture_vertices;
 EX vector<glvertex> floor_texture_map;
 EX struct renderbuffer *floor_textures;
 
+/** \brief when this file was compiled; a part of the version of the shape cache (see shape_cache_header) */
+EX const char *floorshapes_compiled = __DATE__ " " __TIME__;
+
 void geometry_information::init_floorshapes() {
   all_escher_floorshapes.clear();
   all_plain_floorshapes = { 
@@ -92,6 +92,103 @@ struct basic_textureinfo {
   vector<glvertex> tvertices; 
   };
 
+/** the hpcshape members of geometry_information, as S(name, array dimensions), and its hpcshape_animated
+ *  members, as A(name); both the declaration and geometry_information::list_shapes are generated from this list */
+#define GEOMETRY_SHAPES(S, A) \
+  S(shSemiFloorSide, [SIDEPARS]) \
+  S(shBFloor, [2]) \
+  S(shWave, [8][2]) \
+  S(shCircleFloor, ) \
+  S(shBarrel, ) \
+  S(shWall, [2]) S(shMineMark, [2]) S(shBigMineMark, [2]) S(shFan, ) \
+  S(shZebra, [5]) \
+  S(shSwitchDisk, ) \
+  S(shTower, [11]) \
+  S(shEmeraldFloor, [6]) \
+  S(shSemiFeatherFloor, [2]) \
+  S(shSemiFloor, [2]) S(shSemiBFloor, [2]) S(shSemiFloorShadow, ) \
+  S(shMercuryBridge, [2]) \
+  S(shTriheptaSpecial, [14]) \
+  S(shCross, ) S(shGiantStar, [2]) S(shLake, ) S(shMirror, ) \
+  S(shHalfFloor, [6]) S(shHalfMirror, [3]) \
+  S(shGem, [2]) S(shStar, ) S(shDisk, ) S(shDiskT, ) S(shDiskS, ) S(shDiskM, ) S(shDiskSq, ) S(shRing, ) \
+  S(shTinyBird, ) S(shTinyShark, ) \
+  S(shEgg, ) \
+  S(shSpikedRing, ) S(shTargetRing, ) S(shSawRing, ) S(shGearRing, ) S(shPeaceRing, ) S(shHeptaRing, ) \
+  S(shSpearRing, ) S(shLoveRing, ) \
+  S(shFrogRing, ) S(shReserved1, ) S(shReserved2, ) \
+  S(shDaisy, ) S(shTriangle, ) S(shNecro, ) S(shStatue, ) S(shKey, ) S(shWindArrow, ) \
+  S(shGun, ) \
+  S(shFigurine, ) S(shTreat, ) \
+  S(shElementalShard, ) \
+  S(shIBranch, ) S(shTentacle, ) S(shTentacleX, ) S(shILeaf, [3]) \
+  S(shMovestar, ) \
+  S(shWolf, ) S(shYeti, ) S(shDemon, ) S(shGDemon, ) S(shEagle, ) S(shGargoyleWings, ) S(shGargoyleBody, ) \
+  S(shFoxTail1, ) S(shFoxTail2, ) \
+  S(shDogBody, ) S(shDogHead, ) S(shDogFrontLeg, ) S(shDogRearLeg, ) S(shDogFrontPaw, ) S(shDogRearPaw, ) \
+  S(shDogTorso, ) \
+  S(shHawk, ) \
+  S(shCatBody, ) S(shCatLegs, ) S(shCatHead, ) S(shFamiliarHead, ) S(shFamiliarEye, ) \
+  S(shWolf1, ) S(shWolf2, ) S(shWolf3, ) \
+  S(shRatEye1, ) S(shRatEye2, ) S(shRatEye3, ) \
+  S(shDogStripes, ) \
+  S(shPBody, ) S(shPSword, ) S(shPKnife, ) \
+  S(shFerocityM, ) S(shFerocityF, ) \
+  S(shHumanFoot, ) S(shHumanLeg, ) S(shHumanGroin, ) S(shHumanNeck, ) S(shSkeletalFoot, ) S(shYetiFoot, ) \
+  S(shMagicSword, ) S(shMagicShovel, ) S(shSeaTentacle, ) S(shKrakenHead, ) S(shKrakenEye, ) S(shKrakenEye2, ) \
+  S(shArrow, ) \
+  S(shPHead, ) S(shPFace, ) S(shGolemhead, ) S(shHood, ) S(shArmor, ) \
+  S(shAztecHead, ) S(shAztecCap, ) \
+  S(shSabre, ) S(shTurban1, ) S(shTurban2, ) S(shVikingHelmet, ) S(shRaiderHelmet, ) S(shRaiderArmor, ) S(shRaiderBody, ) S(shRaiderShirt, ) \
+  S(shWestHat1, ) S(shWestHat2, ) S(shGunInHand, ) \
+  S(shKnightArmor, ) S(shKnightCloak, ) S(shWightCloak, ) \
+  S(shGhost, ) S(shEyes, ) S(shSlime, ) S(shJelly, ) S(shJoint, ) S(shWormHead, ) S(shTentHead, ) S(shShark, ) S(shWormSegment, ) S(shSmallWormSegment, ) S(shWormTail, ) S(shSmallWormTail, ) \
+  S(shSlimeEyes, ) S(shDragonEyes, ) S(shWormEyes, ) S(shGhostEyes, ) \
+  S(shMiniGhost, ) S(shMiniEyes, ) \
+  S(shHedgehogBlade, ) S(shHedgehogBladePlayer, ) \
+  S(shWolfBody, ) S(shWolfHead, ) S(shWolfLegs, ) S(shWolfEyes, ) \
+  S(shWolfFrontLeg, ) S(shWolfRearLeg, ) S(shWolfFrontPaw, ) S(shWolfRearPaw, ) \
+  S(shFemaleBody, ) S(shFemaleHair, ) S(shFemaleDress, ) S(shWitchDress, ) \
+  S(shWitchHair, ) S(shBeautyHair, ) S(shFlowerHair, ) S(shFlowerHand, ) S(shSuspenders, ) S(shTrophy, ) \
+  S(shBugBody, ) S(shBugArmor, ) S(shBugLeg, ) S(shBugAntenna, ) \
+  S(shPickAxe, ) S(shPike, ) S(shFlailBall, ) S(shFlailTrunk, ) S(shFlailChain, ) S(shHammerHead, ) \
+  S(shBook, ) S(shBookCover, ) S(shGrail, ) \
+  S(shBoatOuter, ) S(shBoatInner, ) S(shCompass1, ) S(shCompass2, ) S(shCompass3, ) \
+  S(shKnife, ) S(shTongue, ) S(shFlailMissile, ) S(shTrapArrow, ) \
+  S(shPirateHook, ) S(shPirateHood, ) S(shEyepatch, ) S(shPirateX, ) \
+  S(shHeptaMarker, ) S(shSnowball, ) S(shSun, ) S(shNightStar, ) S(shEuclideanSky, ) \
+  S(shSkeletonBody, ) S(shSkull, ) S(shSkullEyes, ) S(shFatBody, ) S(shWaterElemental, ) \
+  S(shPalaceGate, ) S(shFishTail, ) \
+  S(shMouse, ) S(shMouseLegs, ) S(shMouseEyes, ) \
+  S(shPrincessDress, ) S(shPrinceDress, ) \
+  S(shWizardCape1, ) S(shWizardCape2, ) \
+  S(shBigCarpet1, ) S(shBigCarpet2, ) S(shBigCarpet3, ) \
+  S(shGoatHead, ) S(shRose, ) S(shRoseItem, ) S(shThorns, ) \
+  S(shRatHead, ) S(shRatTail, ) S(shRatEyes, ) S(shRatCape1, ) S(shRatCape2, ) \
+  S(shWizardHat1, ) S(shWizardHat2, ) \
+  S(shTortoise, [13][6]) \
+  S(shDragonLegs, ) S(shDragonTail, ) S(shDragonHead, ) S(shDragonSegment, ) S(shDragonNostril, ) \
+  S(shDragonWings, ) \
+  S(shSolidBranch, ) S(shWeakBranch, ) S(shBead0, ) S(shBead1, ) \
+  S(shBatWings, ) S(shBatBody, ) S(shBatMouth, ) S(shBatFang, ) S(shBatEye, ) \
+  S(shParticle, [16]) S(shAsteroid, [8]) \
+  S(shReptile, [5][4]) \
+  S(shReptileBody, ) S(shReptileHead, ) S(shReptileFrontFoot, ) S(shReptileRearFoot, ) \
+  S(shReptileFrontLeg, ) S(shReptileRearLeg, ) S(shReptileTail, ) S(shReptileEye, ) \
+  S(shTrylobite, ) S(shTrylobiteHead, ) S(shTrylobiteBody, ) \
+  S(shTrylobiteFrontLeg, ) S(shTrylobiteRearLeg, ) S(shTrylobiteFrontClaw, ) S(shTrylobiteRearClaw, ) \
+  S(shBullBody, ) S(shBullHead, ) S(shBullHorn, ) S(shBullRearHoof, ) S(shBullFrontHoof, ) \
+  S(shButterflyBody, ) S(shButterflyWing, ) S(shGadflyBody, ) S(shGadflyWing, ) S(shGadflyEye, ) \
+  S(shTerraArmor1, ) S(shTerraArmor2, ) S(shTerraArmor3, ) S(shTerraHead, ) S(shTerraFace, ) \
+  S(shJiangShi, ) S(shJiangShiDress, ) S(shJiangShiCap1, ) S(shJiangShiCap2, ) \
+  S(shPikeBody, ) S(shPikeEye, ) \
+  S(shAsymmetric, ) \
+  S(shPBodyOnly, ) S(shPBodyArm, ) S(shPBodyHand, ) S(shPHeadOnly, ) \
+  S(shDodeca, ) \
+  S(shFrogRearFoot, ) S(shFrogFrontFoot, ) S(shFrogRearLeg, ) S(shFrogFrontLeg, ) S(shFrogRearLeg2, ) S(shFrogBody, ) S(shFrogEye, ) S(shFrogStripe, ) S(shFrogJumpFoot, ) S(shFrogJumpLeg, ) \
+  A(shAnimatedEagle) A(shAnimatedTinyEagle) A(shAnimatedGadfly) A(shAnimatedHawk) A(shAnimatedButterfly) \
+  A(shAnimatedGargoyle) A(shAnimatedGargoyle2) A(shAnimatedBat) A(shAnimatedBat2)
+
 /** basic geometry parameters */
 struct geometry_information {
 
@@ -187,113 +284,11 @@ struct geometry_information {
   ld eyelevel_familiar, eyelevel_human, eyelevel_dog;
 
 #if CAP_SHAPES
-hpcshape 
-  shSemiFloorSide[SIDEPARS],
-  shBFloor[2],
-  shWave[8][2],  
-  shCircleFloor,
-  shBarrel,
-  shWall[2], shMineMark[2], shBigMineMark[2], shFan,
-  shZebra[5],
-  shSwitchDisk,
-  shTower[11],
-  shEmeraldFloor[6],
-  shSemiFeatherFloor[2], 
-  shSemiFloor[2], shSemiBFloor[2], shSemiFloorShadow,
-  shMercuryBridge[2],
-  shTriheptaSpecial[14], 
-  shCross, shGiantStar[2], shLake, shMirror,
-  shHalfFloor[6], shHalfMirror[3],
-  shGem[2], shStar, shDisk, shDiskT, shDiskS, shDiskM, shDiskSq, shRing,   
-  shTinyBird, shTinyShark,
-  shEgg,
-  shSpikedRing, shTargetRing, shSawRing, shGearRing, shPeaceRing, shHeptaRing,
-  shSpearRing, shLoveRing,
-  shFrogRing, shReserved1, shReserved2,
-  shDaisy, shTriangle, shNecro, shStatue, shKey, shWindArrow,
-  shGun,
-  shFigurine, shTreat,
-  shElementalShard,
-  // shBranch, 
-  shIBranch, shTentacle, shTentacleX, shILeaf[3], 
-  shMovestar,
-  shWolf, shYeti, shDemon, shGDemon, shEagle, shGargoyleWings, shGargoyleBody,
-  shFoxTail1, shFoxTail2,
-  shDogBody, shDogHead, shDogFrontLeg, shDogRearLeg, shDogFrontPaw, shDogRearPaw,
-  shDogTorso,
-  shHawk,
-  shCatBody, shCatLegs, shCatHead, shFamiliarHead, shFamiliarEye,
-  shWolf1, shWolf2, shWolf3,
-  shRatEye1, shRatEye2, shRatEye3,
-  shDogStripes,
-  shPBody, shPSword, shPKnife,
-  shFerocityM, shFerocityF, 
-  shHumanFoot, shHumanLeg, shHumanGroin, shHumanNeck, shSkeletalFoot, shYetiFoot,
-  shMagicSword, shMagicShovel, shSeaTentacle, shKrakenHead, shKrakenEye, shKrakenEye2,
-  shArrow,
-  shPHead, shPFace, shGolemhead, shHood, shArmor, 
-  shAztecHead, shAztecCap,
-  shSabre, shTurban1, shTurban2, shVikingHelmet, shRaiderHelmet, shRaiderArmor, shRaiderBody, shRaiderShirt,
-  shWestHat1, shWestHat2, shGunInHand,
-  shKnightArmor, shKnightCloak, shWightCloak,
-  shGhost, shEyes, shSlime, shJelly, shJoint, shWormHead, shTentHead, shShark, shWormSegment, shSmallWormSegment, shWormTail, shSmallWormTail,
-  shSlimeEyes, shDragonEyes, shWormEyes, shGhostEyes,
-  shMiniGhost, shMiniEyes,
-  shHedgehogBlade, shHedgehogBladePlayer,
-  shWolfBody, shWolfHead, shWolfLegs, shWolfEyes,
-  shWolfFrontLeg, shWolfRearLeg, shWolfFrontPaw, shWolfRearPaw,
-  shFemaleBody, shFemaleHair, shFemaleDress, shWitchDress,
-  shWitchHair, shBeautyHair, shFlowerHair, shFlowerHand, shSuspenders, shTrophy,
-  shBugBody, shBugArmor, shBugLeg, shBugAntenna,
-  shPickAxe, shPike, shFlailBall, shFlailTrunk, shFlailChain, shHammerHead,
-  shBook, shBookCover, shGrail,
-  shBoatOuter, shBoatInner, shCompass1, shCompass2, shCompass3,
-  shKnife, shTongue, shFlailMissile, shTrapArrow,
-  shPirateHook, shPirateHood, shEyepatch, shPirateX,
-  // shScratch, 
-  shHeptaMarker, shSnowball, shSun, shNightStar, shEuclideanSky,
-  shSkeletonBody, shSkull, shSkullEyes, shFatBody, shWaterElemental,
-  shPalaceGate, shFishTail,
-  shMouse, shMouseLegs, shMouseEyes,
-  shPrincessDress, shPrinceDress,
-  shWizardCape1, shWizardCape2,
-  shBigCarpet1, shBigCarpet2, shBigCarpet3,
-  shGoatHead, shRose, shRoseItem, shThorns,
-  shRatHead, shRatTail, shRatEyes, shRatCape1, shRatCape2,
-  shWizardHat1, shWizardHat2,
-  shTortoise[13][6],
-  shDragonLegs, shDragonTail, shDragonHead, shDragonSegment, shDragonNostril, 
-  shDragonWings, 
-  shSolidBranch, shWeakBranch, shBead0, shBead1,
-  shBatWings, shBatBody, shBatMouth, shBatFang, shBatEye,
-  shParticle[16], shAsteroid[8],
-  shReptile[5][4],
-  shReptileBody, shReptileHead, shReptileFrontFoot, shReptileRearFoot,
-  shReptileFrontLeg, shReptileRearLeg, shReptileTail, shReptileEye,
-
-  shTrylobite, shTrylobiteHead, shTrylobiteBody,
-  shTrylobiteFrontLeg, shTrylobiteRearLeg, shTrylobiteFrontClaw, shTrylobiteRearClaw,
-  
-  shBullBody, shBullHead, shBullHorn, shBullRearHoof, shBullFrontHoof,
-  
-  shButterflyBody, shButterflyWing, shGadflyBody, shGadflyWing, shGadflyEye,
-
-  shTerraArmor1, shTerraArmor2, shTerraArmor3, shTerraHead, shTerraFace, 
-  shJiangShi, shJiangShiDress, shJiangShiCap1, shJiangShiCap2,
-  
-  shPikeBody, shPikeEye,
-  
-  shAsymmetric,
-  
-  shPBodyOnly, shPBodyArm, shPBodyHand, shPHeadOnly,
-  
-  shDodeca;
-  
-  hpcshape shFrogRearFoot, shFrogFrontFoot, shFrogRearLeg, shFrogFrontLeg, shFrogRearLeg2, shFrogBody, shFrogEye, shFrogStripe, shFrogJumpFoot, shFrogJumpLeg;
-
-  hpcshape_animated 
-    shAnimatedEagle, shAnimatedTinyEagle, shAnimatedGadfly, shAnimatedHawk, shAnimatedButterfly, 
-    shAnimatedGargoyle, shAnimatedGargoyle2, shAnimatedBat, shAnimatedBat2;  
+  #define DECLARE_HPCSHAPE(name, dims) hpcshape name dims;
+  #define DECLARE_ANIMATED(name) hpcshape_animated name;
+  GEOMETRY_SHAPES(DECLARE_HPCSHAPE, DECLARE_ANIMATED)
+  #undef DECLARE_HPCSHAPE
+  #undef DECLARE_ANIMATED
 
   map<int, hpcshape> shPipe;
 
@@ -431,6 +426,12 @@ hpcshape
   void queueball(const transmatrix& V, ld rad, color_t col, eItem what);
   void make_shadow(hpcshape& sh);
   void make_3d_models();
+
+  void list_shapes(vector<hpcshape*>& res, bool with_floorshapes);
+  bool save_shapes(struct hstream& hs);
+  void load_shapes(struct hstream& hs);
+  bool load_cached_shapes();
+  void save_cached_shapes();
   
   /* Goldberg parameters */
   #if CAP_GP
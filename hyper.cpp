@@ -28,6 +28,7 @@
 #include "raycaster.cpp"
 #include "hprint.cpp"
 #include "util.cpp"
+#include "threads.cpp"
 #include "hyperpoint.cpp"
 #include "patterns.cpp"
 #include "fieldpattern.cpp"
@@ -104,6 +104,91 @@ struct hyperpoint : array<ld, MAXMDIM> {
     }    
   };
 
+#if CAP_SIMD
+/** \brief SIMD kernels for the products of transmatrix, for MDIM of 3 or 4
+ *
+ *  The matrices are stored by rows, so the product of matrices is computed row by row, 
+ *  and the columns are extracted for the product of a matrix and a point. The terms 
+ *  are added in the same order as in the scalar loops, so the results are identical
+ *  unless the compiler contracts multiplications and additions into FMA differently
+ *  in the two versions (e.g. GCC's default -ffp-contract=fast on targets with FMA);
+ *  then they may differ in the last bits.
+ *  Entries beyond MDIM are not meaningful, as in the scalar version.
+ */
+namespace simd {
+
+#ifdef __AVX__
+  typedef __m256d row;
+  inline row load(const ld *a) { return _mm256_loadu_pd(a); }
+  inline void store(ld *a, row r) { _mm256_storeu_pd(a, r); }
+  inline row zero() { return _mm256_setzero_pd(); }
+  inline row muladd(row acc, row a, ld b) { return _mm256_add_pd(acc, _mm256_mul_pd(a, _mm256_set1_pd(b))); }
+  inline row lincomb(row a, ld wa, row b, ld wb) { return _mm256_add_pd(_mm256_mul_pd(a, _mm256_set1_pd(wa)), _mm256_mul_pd(b, _mm256_set1_pd(wb))); }
+  /** three floats (and 0) as a row */
+  inline row load_floats3(const float *p) { return _mm256_cvtps_pd(_mm_set_ps(0, p[2], p[1], p[0])); }
+
+  /** columns of the 4x4 matrix T */
+  inline void columns(const ld (*T)[MAXMDIM], row *c) {
+    row r0 = load(T[0]), r1 = load(T[1]), r2 = load(T[2]), r3 = load(T[3]);
+    row t0 = _mm256_unpacklo_pd(r0, r1), t1 = _mm256_unpackhi_pd(r0, r1);
+    row t2 = _mm256_unpacklo_pd(r2, r3), t3 = _mm256_unpackhi_pd(r2, r3);
+    c[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+    c[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+    c[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+    c[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+    }
+#else
+  /** without AVX, a row of four ld's is kept in two SSE2 registers */
+  struct row { __m128d lo, hi; };
+  inline row load(const ld *a) { return row{_mm_loadu_pd(a), _mm_loadu_pd(a+2)}; }
+  inline void store(ld *a, row r) { _mm_storeu_pd(a, r.lo); _mm_storeu_pd(a+2, r.hi); }
+  inline row zero() { return row{_mm_setzero_pd(), _mm_setzero_pd()}; }
+  inline row muladd(row acc, row a, ld b) {
+    __m128d bb = _mm_set1_pd(b);
+    return row{_mm_add_pd(acc.lo, _mm_mul_pd(a.lo, bb)), _mm_add_pd(acc.hi, _mm_mul_pd(a.hi, bb))};
+    }
+  inline row lincomb(row a, ld wa, row b, ld wb) {
+    __m128d aa = _mm_set1_pd(wa), bb = _mm_set1_pd(wb);
+    return row{_mm_add_pd(_mm_mul_pd(a.lo, aa), _mm_mul_pd(b.lo, bb)), _mm_add_pd(_mm_mul_pd(a.hi, aa), _mm_mul_pd(b.hi, bb))};
+    }
+  inline row load_floats3(const float *p) {
+    __m128 v = _mm_set_ps(0, p[2], p[1], p[0]);
+    return row{_mm_cvtps_pd(v), _mm_cvtps_pd(_mm_movehl_ps(v, v))};
+    }
+
+  inline void columns(const ld (*T)[MAXMDIM], row *c) {
+    for(int j=0; j<4; j+=2) {
+      __m128d r0 = _mm_loadu_pd(T[0]+j), r1 = _mm_loadu_pd(T[1]+j);
+      __m128d r2 = _mm_loadu_pd(T[2]+j), r3 = _mm_loadu_pd(T[3]+j);
+      c[j] = row{_mm_unpacklo_pd(r0, r1), _mm_unpacklo_pd(r2, r3)};
+      c[j+1] = row{_mm_unpackhi_pd(r0, r1), _mm_unpackhi_pd(r2, r3)};
+      }
+    }
+#endif
+
+  /** sum of c[j] * H[j]; this is T*H if c are the columns of T, and a row of T*U if c are the rows of U */
+  template<int dim> inline void apply_columns(const row *c, const ld *H, ld *res) {
+    row z = muladd(zero(), c[0], H[0]);
+    z = muladd(z, c[1], H[1]);
+    z = muladd(z, c[2], H[2]);
+    if(dim == 4) z = muladd(z, c[3], H[3]);
+    store(res, z);
+    }
+
+  template<int dim> inline void mul_mv(const ld (*T)[MAXMDIM], const ld *H, ld *res) {
+    row c[4];
+    columns(T, c);
+    apply_columns<dim>(c, H, res);
+    }
+
+  template<int dim> inline void mul_mm(const ld (*T)[MAXMDIM], const ld (*U)[MAXMDIM], ld (*res)[MAXMDIM]) {
+    row u[4];
+    for(int k=0; k<dim; k++) u[k] = load(U[k]);
+    for(int i=0; i<dim; i++) apply_columns<dim>(u, T[i], res[i]);
+    }
+  }
+#endif
+
 /** \brief A matrix acting on hr::hyperpoint 
  *
  *  Since we are using homogeneous coordinates for hr::hyperpoint,
@@ -118,6 +203,10 @@ struct transmatrix {
   
   inline friend hyperpoint operator * (const transmatrix& T, const hyperpoint& H) {
     hyperpoint z;
+    #if CAP_SIMD
+    if(MDIM == 4) { simd::mul_mv<4>(T.tab, &H[0], &z[0]); return z; }
+    if(MDIM == 3) { simd::mul_mv<3>(T.tab, &H[0], &z[0]); return z; }
+    #endif
     for(int i=0; i<MDIM; i++) {
       z[i] = 0;
       for(int j=0; j<MDIM; j++) z[i] += T[i][j] * H[j];
@@ -127,6 +216,10 @@ struct transmatrix {
 
   inline friend transmatrix operator * (const transmatrix& T, const transmatrix& U) {
     transmatrix R;
+    #if CAP_SIMD
+    if(MDIM == 4) { simd::mul_mm<4>(T.tab, U.tab, R.tab); return R; }
+    if(MDIM == 3) { simd::mul_mm<3>(T.tab, U.tab, R.tab); return R; }
+    #endif
     for(int i=0; i<MDIM; i++) for(int j=0; j<MDIM; j++) {
       R[i][j] = 0;
       for(int k=0; k<MDIM; k++)
@@ -879,6 +972,20 @@ EX void orthonormalize(transmatrix& T) {
     }
   }
 
+/** apply T to n points: res[i] = T * h[i]; h and res may be the same array */
+EX void apply_to_points(const transmatrix& T, const hyperpoint *h, hyperpoint *res, int n) {
+  #if CAP_SIMD
+  if(MDIM == 3 || MDIM == 4) {
+    simd::row c[4];
+    simd::columns(T.tab, c);
+    if(MDIM == 4) for(int i=0; i<n; i++) simd::apply_columns<4>(c, &h[i][0], &res[i][0]);
+    else for(int i=0; i<n; i++) simd::apply_columns<3>(c, &h[i][0], &res[i][0]);
+    return;
+    }
+  #endif
+  for(int i=0; i<n; i++) res[i] = T * h[i];
+  }
+
 /** determinant 2x2 */
 EX ld det2(const transmatrix& T) {
   return T[0][0] * T[1][1] - T[0][1] * T[1][0];
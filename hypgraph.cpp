@@ -2183,42 +2183,97 @@ EX shiftmatrix optimized_shift(const shiftmatrix& T) {
   }
 
 EX namespace dq {
+  #if HDR
+  /** the visited sets below are refilled every frame, so they are not trees but open addressing
+   *  tables with linear probing; a slot is used iff its stamp equals the current generation,
+   *  so clear() does not need to touch the table */
+  template<class T> struct stamped_set {
+    vector<T> keys;
+    vector<unsigned> stamps;
+    unsigned generation = 1;
+    int qty = 0;
+    int bits = 0;
+
+    size_t slot(T x) const {
+      return size_t((uint64_t(std::hash<T>()(x)) * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+      }
+
+    int size() const { return qty; }
+
+    bool count(T x) const {
+      if(!qty) return false;
+      size_t mask = keys.size() - 1;
+      for(size_t i = slot(x);; i = (i+1) & mask) {
+        if(stamps[i] != generation) return false;
+        if(keys[i] == x) return true;
+        }
+      }
+
+    /** returns true iff x was not in the set yet */
+    bool insert(T x) {
+      if(2 * (qty+1) > isize(keys)) grow();
+      size_t mask = keys.size() - 1;
+      for(size_t i = slot(x);; i = (i+1) & mask) {
+        if(stamps[i] != generation) { stamps[i] = generation; keys[i] = x; qty++; return true; }
+        if(keys[i] == x) return false;
+        }
+      }
+
+    void clear() {
+      qty = 0;
+      if(++generation == 0) {
+        for(auto& s: stamps) s = 0;
+        generation = 1;
+        }
+      }
+
+    void grow() {
+      vector<T> old_keys;
+      vector<unsigned> old_stamps;
+      swap(old_keys, keys); swap(old_stamps, stamps);
+      unsigned old_generation = generation;
+      bits = max(bits+1, 8);
+      keys.resize(size_t(1) << bits);
+      stamps.assign(size_t(1) << bits, 0);
+      generation = 1; qty = 0;
+      for(int i=0; i<isize(old_keys); i++)
+        if(old_stamps[i] == old_generation) insert(old_keys[i]);
+      }
+    };
+  #endif
+
   EX queue<pair<heptagon*, shiftmatrix>> drawqueue;
   
   EX unsigned bucketer(const shiftpoint& T) {
     return bucketer(T.h) + unsigned(floor(T.shift*81527+.5));
     }
 
-  EX set<heptagon*> visited;
+  EX stamped_set<heptagon*> visited;
   EX void enqueue(heptagon *h, const shiftmatrix& T) {
-    if(!h || visited.count(h)) { return; }
-    visited.insert(h);
+    if(!h || !visited.insert(h)) { return; }
     drawqueue.emplace(h, T);
     }  
 
-  EX set<unsigned> visited_by_matrix;
+  EX stamped_set<unsigned> visited_by_matrix;
   EX void enqueue_by_matrix(heptagon *h, const shiftmatrix& T) {
     if(!h) return;
     unsigned b = bucketer(tC0(T));
-    if(visited_by_matrix.count(b)) { return; }
-    visited_by_matrix.insert(b);
+    if(!visited_by_matrix.insert(b)) { return; }
     drawqueue.emplace(h, T);
     }
 
   EX queue<pair<cell*, shiftmatrix>> drawqueue_c;
-  EX set<cell*> visited_c;
+  EX stamped_set<cell*> visited_c;
 
   EX void enqueue_c(cell *c, const shiftmatrix& T) {
-    if(!c || visited_c.count(c)) { return; }
-    visited_c.insert(c);
+    if(!c || !visited_c.insert(c)) { return; }
     drawqueue_c.emplace(c, T);
     }
 
   EX void enqueue_by_matrix_c(cell *c, const shiftmatrix& T) {
     if(!c) return;
     unsigned b = bucketer(tC0(T));
-    if(visited_by_matrix.count(b)) { return; }
-    visited_by_matrix.insert(b);
+    if(!visited_by_matrix.insert(b)) { return; }
     drawqueue_c.emplace(c, T);
     }
   
@@ -2235,7 +2290,7 @@ EX namespace dq {
 
 EX bool do_draw(cell *c) {
   // do not display out of range cells, unless on torus
-  if(c->pathdist == PINFD && !(euclid && quotient) && vid.use_smart_range == 0)
+  if(!graphical_search.reached(c) && !(euclid && quotient) && vid.use_smart_range == 0)
     return false;
   // do not display not fully generated cells, unless changing range allowed
   if(c->mpdist > 7 && !allowChangeRange()) return false;
@@ -42,7 +42,6 @@ struct gcell {
 
   signed 
     mpdist : 7,         ///< minimum player distance, the smaller value, the more generated it is */
-    pathdist : 8,       ///< distance from the target -- actual meaning may change
     cpdist : 8;         ///< current distance to the player
 
   unsigned 
@@ -60,7 +59,7 @@ struct gcell {
   eItem item;
   eLand barleft, barright;
   bool ligon, monmirror;
-  signed char pathdist, cpdist, mpdist;
+  signed char cpdist, mpdist;
   
   unsigned char mondir, bardir, stuntime, hitpoints;
   unsigned char landflags;
@@ -121,7 +120,7 @@ template<class T> struct walker;
  *  we are connected to, as well as the index of this edge in the other T, and whether it is 
  *  mirrored (for graphs on non-orientable manifolds).
  *  To conserve memory, these classes need to be allocated with tailored_alloc
- *  and freed with tailored_free.
+ *  and freed with tailored_delete.
  */
 
 int gmod(int i, int j);
@@ -169,6 +168,73 @@ template<class T> struct connection_table {
     }
   };
 
+/** \brief Slab allocator used by hr::tailored_alloc.
+ *
+ *  Objects are carved from large blocks. Freed objects are kept on free lists,
+ *  one for each degree, and reused for the next object of the same degree,
+ *  so generating and destroying millions of cells does not call malloc for
+ *  every one of them. When no object allocated from the arena is alive
+ *  (e.g., after all the maps have been destroyed), release() returns all the
+ *  blocks at once.
+ */
+struct tailored_arena {
+  /** \brief size of a single block */
+  static const int block_size = 1 << 18;
+  /** \brief all the blocks allocated so far */
+  vector<char*> blocks;
+  /** \brief the unused part of the last block */
+  char *bump, *bump_end;
+  /** \brief free lists indexed by degree; the link is stored in the first bytes of the object */
+  array<char*, FULL_EDGE+1> free_list;
+  /** \brief number of objects currently alive */
+  int live;
+  /** \brief number of objects on the free lists */
+  int freed;
+  /** \brief total bytes handed out from the blocks (including freed objects) */
+  size_t used_bytes;
+
+  tailored_arena() : bump(nullptr), bump_end(nullptr), live(0), freed(0), used_bytes(0) { free_list.fill(nullptr); }
+
+  char *allocate(int degree, int size) {
+    live++;
+    char*& fl = free_list[degree];
+    if(fl) {
+      char *res = fl;
+      fl = *(char**) res;
+      freed--;
+      return res;
+      }
+    size = (size + sizeof(char*) - 1) & ~int(sizeof(char*) - 1);
+    if(bump + size > bump_end) {
+      bump = new char[block_size];
+      bump_end = bump + block_size;
+      blocks.push_back(bump);
+      }
+    char *res = bump;
+    bump += size;
+    used_bytes += size;
+    return res;
+    }
+
+  void deallocate(void *x, int degree) {
+    live--;
+    char*& fl = free_list[degree];
+    *(char**) x = fl;
+    fl = (char*) x;
+    freed++;
+    }
+
+  size_t reserved_bytes() const { return size_t(block_size) * blocks.size(); }
+
+  bool release();
+  };
+
+/** \brief the arena used for objects of type T */
+template<class T> tailored_arena& arena_of() {
+  static tailored_arena arena;
+  return arena;
+  }
+
 /** \brief Allocate a class T with a connection_table, but with only `degree` connections. 
  *
  *  Also set yet unknown connections to NULL.
@@ -182,7 +248,7 @@ template<class T> T* tailored_alloc(int degree) {
   T* result;
 #ifndef NO_TAILORED_ALLOC
   int b = (char*)&sample->c.move_table[degree] + degree - (char*) sample;
-  result = (T*) new char[b];
+  result = (T*) arena_of<T>().allocate(degree, b);
   new (result) T();
 #else
   result = new T;
@@ -194,8 +260,13 @@ template<class T> T* tailored_alloc(int degree) {
 
 /** \brief Counterpart to hr::tailored_alloc(). */
 template<class T> void tailored_delete(T* x) {
-  x->~T();  
-  delete[] ((char*) (x));
+#ifndef NO_TAILORED_ALLOC
+  int degree = x->type;
+  x->~T();
+  arena_of<T>().deallocate(x, degree);
+#else
+  delete x;
+#endif
   }
 
 static const struct wstep_t { wstep_t() {} } wstep;
@@ -356,11 +427,17 @@ struct heptagon {
   heptagon& operator=(const heptagon&) = delete;
   };
 
+/** the number of bfs_search objects which may be in progress at once (see environment.cpp) */
+constexpr int BFS_KINDS = 2;
+
 struct cell : gcell {
   char type;        ///< our degree
   int degree() { return type; }
 
+  signed char pathdist[BFS_KINDS]; ///< distance found by the bfs_search of each kind -- actual meaning may change
+
   int listindex;    ///< used by celllister  
+  unsigned pathstamp[BFS_KINDS]; ///< pathdist[k] is valid for the bfs_search of kind k with this stamp
   heptagon *master; ///< heptagon who owns us; for 'masterless' tilings it contains coordinates instead
 
   connection_table<cell> c;
@@ -489,6 +566,18 @@ struct movei {
   };
 #endif
 
+/** \brief return all the blocks to the system; only possible when no object is alive */
+bool tailored_arena::release() {
+  if(live) return false;
+  for(char *b: blocks) delete[] b;
+  blocks.clear();
+  bump = bump_end = nullptr;
+  free_list.fill(nullptr);
+  freed = 0;
+  used_bytes = 0;
+  return true;
+  }
+
 EX movei moveimon(cell *c) { return movei(c, c->mondir); }
 
 EX movei match(cell *f, cell *t) {
@@ -11,7 +11,10 @@ namespace hr {
 EX void initcell(cell *c) {
   c->mpdist = INFD;   // minimum distance from the player, ever
   c->cpdist = INFD;   // current distance from the player
-  c->pathdist = PINFD;// current distance from the player, along paths (used by yetis)
+  for(int k=0; k<BFS_KINDS; k++) {
+    c->pathdist[k] = PINFD; // current distance from the player, along paths (used by yetis)
+    c->pathstamp[k] = 0;    // not reached by any bfs_search yet
+    }
   c->landparam = 0; c->landflags = 0; c->wparam = 0;
   c->listindex = -1;
   c->wall  = waNone;
@@ -545,7 +545,7 @@ EX void wandering() {
         c->monst = eMonster(moWitch + hrand(NUMWITCH));
       }
     
-    else if(c->monst || c->pathdist == PINFD) break;
+    else if(c->monst || !path_search.reached(c)) break;
     
     else if(c->land == laAsteroids) {
       int gen = 0;
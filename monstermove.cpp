@@ -498,14 +498,14 @@ EX int moveval(cell *c1, cell *c2, int d, flagtype mf) {
     return 1500 - bulldist(c2);
   
   // actually they just run away
-  if(m == moHunterChanging && c2->pathdist > c1->pathdist) return 1600;
+  if(m == moHunterChanging && path_distance(c2) > path_distance(c1)) return 1600;
   
-  if((mf & MF_PATHDIST) && !pathlock) printf("using MF_PATHDIST without path\n"); 
+  if((mf & MF_PATHDIST) && !path_search.current()) printf("using MF_PATHDIST without path\n"); 
   
   int bonus = 0;
   if(m == moBrownBug && snakelevel(c2) < snakelevel(c1)) bonus = -10;
 
-  if(hunt && (mf & MF_PATHDIST) && c2->pathdist < c1->pathdist && !peace::on) return 1500 + bonus; // good move
+  if(hunt && (mf & MF_PATHDIST) && path_distance(c2) < path_distance(c1) && !peace::on) return 1500 + bonus; // good move
   
   // prefer straight direction when wandering
   int dd = angledist(c1, c1->mondir, d);
@@ -979,7 +979,7 @@ EX void moveivy() {
     if(c->monst != moIvyHead) continue;
     ivynext(c);
 
-    int pd = c->pathdist;
+    int pd = path_distance(c);
     
     movei mi(nullptr, nullptr, NODIR);
       
@@ -1008,8 +1008,8 @@ EX void moveivy() {
             }
           continue;
           }
-        if(c2 && c2->pathdist < pd && passable(c2, c, 0) && !strictlyAgainstGravity(c2, c, false, MF_IVY))
-          mi = movei(c, j), pd = c2->pathdist;
+        if(c2 && path_distance(c2) < pd && passable(c2, c, 0) && !strictlyAgainstGravity(c2, c, false, MF_IVY))
+          mi = movei(c, j), pd = path_distance(c2);
         }
       c = c->move(c->mondir);
       }
@@ -1050,7 +1050,7 @@ EX void groupmove2(const movei& mi, eMonster movtype, flagtype mf) {
   auto& from = mi.t; // note: we are moving from 'c' to 'from'!'
   if(!c) return;
 
-  if(c->pathdist == 0) return;
+  if(path_distance(c) == 0) return;
 
   if(movtype == moKrakenH && isTargetOrAdjacent(from)) ;
 /*  else if(passable_for(movtype, from, c, P_ONPLAYER | P_CHAIN | P_MONSTER)) ;
@@ -1198,7 +1198,7 @@ EX void groupmove(eMonster movtype, flagtype mf) {
   if(movtype != moDragonHead) for(int i=0; i<isize(dcal); i++) {
     cell *c = dcal[i];
     if((mf & MF_ONLYEAGLE) && c->monst != moEagle && c->monst != moBat) return;
-    if(movegroup(c->monst) == movtype && c->pathdist != 0) {
+    if(movegroup(c->monst) == movtype && path_distance(c) != 0) {
       cell *c2 = moveNormal(c, mf);
       if(c2) onpath(c2, 0);
       }
@@ -1266,7 +1266,7 @@ EX int snake_pair(cell *c) {
 EX void hexvisit(cell *c, cell *from, int d, bool mounted, int colorpair) {
   if(!c) return;
   if(cellUnstable(c) || cellEdgeUnstable(c)) return;
-  if(c->pathdist == 0) return;
+  if(path_distance(c) == 0) return;
   
   if(cellUnstableOrChasm(c) || cellUnstableOrChasm(from)) return;
   
@@ -1572,9 +1572,9 @@ EX int movevalue(eMonster m, cell *c, cell *c2, flagtype flags) {
     // fourth rule: do not get too far from the Rogue
     // NOTE: since Mouse is not a target, we can use
     // the full pathfinding here instead of cpdist!
-    else if(c2->pathdist > 3 && c2->pathdist <= 19)
-      val -= (500+c2->pathdist * 10);
-    else if(c2->pathdist > 19)
+    else if(path_distance(c2) > 3 && path_distance(c2) <= 19)
+      val -= (500+path_distance(c2) * 10);
+    else if(path_distance(c2) > 19)
       val -= (700);
     // fifth rule: get close to the Princess, to point the way
     else
@@ -1772,7 +1772,7 @@ EX void specialMoves() {
       cell *gtab[8], *ztab[8];
       for(int j=0; j<c->type; j++) if(c->move(j)) {
         if(c->move(j)->wall == waFreshGrave) gtab[gravenum++] = c->move(j);
-        if(passable(c->move(j), c, 0) && c->move(j)->pathdist < c->pathdist)
+        if(passable(c->move(j), c, 0) && path_distance(c->move(j)) < path_distance(c))
           ztab[zombienum++] = c->move(j);
         }
       if(gravenum && zombienum) {
@@ -1906,7 +1906,7 @@ EX void consMove(cell *c, eMonster param) {
     int goodmoves = 0;
     for(int t=0; t<c->type; t++) {
       cell *c2 = c->move(t);
-      if(c2 && c2->pathdist < c->pathdist)
+      if(c2 && path_distance(c2) < path_distance(c))
         goodmoves++;
       }
     movesofgood.grow(goodmoves).push_back(c);
@@ -1926,7 +1926,7 @@ EX void moveNormals(eMonster param) {
   int dcs = isize(dcal);
   for(int i=0; i<dcs; i++) {
     cell *c = dcal[i];
-    if(c->pathdist == PINFD) consMove(c, param);
+    if(path_distance(c) == PINFD) consMove(c, param);
     }
 
   for(auto& v: movesofgood) for(cell *c: v) {
@@ -62,39 +62,171 @@ EX namespace sn {
   inline hyperpoint decompress(compressed_point p) { return point3(p[0], p[1], p[2]); }
   inline compressed_point compress(hyperpoint h) { return make_array<float>(h[0], h[1], h[2]); }
 
+  /** \brief the header of geodesic table files
+   *
+   *  It is followed by the checksums of the blocks of block_size points, and then by the points.
+   *  Legacy files contain just the three dimensions, followed by the points.
+   */
+  struct geodesic_table_header {
+    char magic[4];
+    int version;
+    int prec[3];
+    int block_size;
+    int blocks;
+    };
+
   struct tabled_inverses {
     int PRECX, PRECY, PRECZ;
+    /** the points of a table built (rather than loaded) */
     vector<compressed_point> tab;
+    /** the points: tab, or the file mapped into memory */
+    compressed_point *data;
+    /** the checksums of the blocks, or NULL if not known */
+    const unsigned *checksums;
+    int block_size, blocks;
+    /** the file contents, if it could not be mapped into memory */
+    vector<char> contents;
     string fname;
     bool loaded;
     
     void load();
+    void allocate(int X, int Y, int Z);
+    void save(const string& s);
+    int validate(int samples);
     hyperpoint get(ld ix, ld iy, ld iz, bool lazy);
     
-    compressed_point& get_int(int ix, int iy, int iz) { return tab[(iz*PRECY+iy)*PRECX+ix]; }
+    compressed_point& get_int(int ix, int iy, int iz) { return data[(iz*PRECY+iy)*PRECX+ix]; }
   
     GLuint texture_id;
     bool toload;
     
     GLuint get_texture_id();
   
-    tabled_inverses(string s) : fname(s), texture_id(0), toload(true) {}  
+    tabled_inverses(string s) : data(nullptr), checksums(nullptr), block_size(0), blocks(0), fname(s), loaded(false), texture_id(0), toload(true) {}  
     };
   #endif
-  
+
+  static const char *geodesic_table_magic = "HRGT";
+
+  /** the number of points in a checksummed block of a geodesic table */
+  EX int geodesic_block_size = 1024;
+
+  unsigned table_checksum(const compressed_point *p, size_t qty) {
+    auto b = (const unsigned char*) p;
+    unsigned h = 2166136261u;
+    for(size_t i=0; i<qty * sizeof(compressed_point); i++) h = (h ^ b[i]) * 16777619u;
+    return h;
+    }
+
+  /** the table is mapped into memory (when possible) rather than read, so that the pages are loaded only when used,
+   *  and shared by all the processes using the same table; the mapping is private, so the table can still be modified */
   void tabled_inverses::load() {
     if(loaded) return;
-    FILE *f = fopen(fname.c_str(), "rb");
-    if(!f) f = fopen((rsrcdir + fname).c_str(), "rb");
+    string name = fname;
+    FILE *f = fopen(name.c_str(), "rb");
+    if(!f) name = rsrcdir + fname, f = fopen(name.c_str(), "rb");
     if(!f) { addMessage(XLAT("geodesic table missing")); pmodel = mdPerspective; return; }
-    ignore(fread(&PRECX, 4, 1, f));
-    ignore(fread(&PRECY, 4, 1, f));
-    ignore(fread(&PRECZ, 4, 1, f));
-    tab.resize(PRECX * PRECY * PRECZ);
-    ignore(fread(&tab[0], sizeof(compressed_point) * PRECX * PRECY * PRECZ, 1, f));
+    fseek(f, 0, SEEK_END);
+    size_t size = ftell(f);
+    char *buf = nullptr;
+    #if CAP_MMAP
+    void *m = size ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(f), 0) : MAP_FAILED;
+    if(m != MAP_FAILED) buf = (char*) m;
+    #endif
+    if(!buf) {
+      contents.resize(size);
+      fseek(f, 0, SEEK_SET);
+      if(size) ignore(fread(contents.data(), size, 1, f));
+      buf = contents.data();
+      }
     fclose(f);
+
+    /* the header is read only if the file is long enough, and copied, since buf is not necessarily aligned */
+    size_t offset;
+    geodesic_table_header hd;
+    bool versioned = size >= sizeof(hd);
+    if(versioned) {
+      memcpy(&hd, buf, sizeof(hd));
+      versioned = memcmp(hd.magic, geodesic_table_magic, 4) == 0 && hd.version == 1;
+      }
+    PRECX = PRECY = PRECZ = 0;
+    checksums = nullptr; data = nullptr; block_size = blocks = 0;
+    if(versioned) {
+      PRECX = hd.prec[0]; PRECY = hd.prec[1]; PRECZ = hd.prec[2];
+      block_size = hd.block_size; blocks = hd.blocks;
+      offset = sizeof(hd) + sizeof(unsigned) * max(blocks, 0);
+      }
+    else {
+      if(size >= 12) memcpy(&PRECX, buf, 4), memcpy(&PRECY, buf+4, 4), memcpy(&PRECZ, buf+8, 4);
+      offset = 12;
+      }
+
+    auto dim_ok = [] (int p) { return p > 1 && p < (1<<20); };
+    size_t points = size_t(PRECX) * PRECY * PRECZ;
+    bool ok = dim_ok(PRECX) && dim_ok(PRECY) && dim_ok(PRECZ) && size >= offset && (size - offset) / sizeof(compressed_point) >= points;
+    if(versioned && (block_size <= 0 || blocks != int((points + block_size - 1) / block_size))) ok = false;
+    if(ok) {
+      if(versioned) checksums = (const unsigned*) (buf + sizeof(hd));
+      data = (compressed_point*) (buf + offset);
+      }
+    else {
+      println(hlog, "geodesic table corrupt: ", name);
+      #if CAP_MMAP
+      if(size && contents.empty()) munmap(buf, size);
+      #endif
+      contents.clear();
+      addMessage(XLAT("geodesic table missing")); pmodel = mdPerspective; return;
+      }
     loaded = true;    
     }
+
+  void tabled_inverses::allocate(int X, int Y, int Z) {
+    PRECX = X; PRECY = Y; PRECZ = Z;
+    tab.resize(X*Y*Z);
+    data = &tab[0];
+    checksums = nullptr;
+    }
+
+  void tabled_inverses::save(const string& s) {
+    FILE *f = fopen(s.c_str(), "wb");
+    if(!f) { println(hlog, "cannot write ", s); return; }
+    size_t points = size_t(PRECX) * PRECY * PRECZ;
+    geodesic_table_header hd;
+    memcpy(hd.magic, geodesic_table_magic, 4);
+    hd.version = 1;
+    hd.prec[0] = PRECX; hd.prec[1] = PRECY; hd.prec[2] = PRECZ;
+    hd.block_size = geodesic_block_size;
+    hd.blocks = (points + hd.block_size - 1) / hd.block_size;
+    vector<unsigned> sums(hd.blocks);
+    for(int b=0; b<hd.blocks; b++)
+      sums[b] = table_checksum(data + size_t(b) * hd.block_size, min<size_t>(hd.block_size, points - size_t(b) * hd.block_size));
+    fwrite(&hd, sizeof(hd), 1, f);
+    fwrite(&sums[0], sizeof(unsigned) * hd.blocks, 1, f);
+    fwrite(data, sizeof(compressed_point) * points, 1, f);
+    fclose(f);
+    }
+
+  /** verify the checksums of the given number of randomly chosen blocks (or of all blocks, if samples is 0);
+   *  returns the number of blocks which do not match, or -1 if the table could not be loaded;
+   *  the blocks are chosen with hrand, so -fixx makes the choice reproducible */
+  int tabled_inverses::validate(int samples) {
+    load();
+    if(!loaded) return -1;
+    if(!checksums) {
+      println(hlog, fname, ": no checksums (legacy format)");
+      return 0;
+      }
+    size_t points = size_t(PRECX) * PRECY * PRECZ;
+    int qty = samples ? min(samples, blocks) : blocks;
+    int bad = 0;
+    for(int i=0; i<qty; i++) {
+      int b = samples ? hrand(blocks) : i;
+      size_t start = size_t(b) * block_size;
+      if(table_checksum(data + start, min<size_t>(block_size, points - start)) != checksums[b]) bad++;
+      }
+    println(hlog, fname, ": checked ", qty, " of ", blocks, " blocks, ", bad, " bad");
+    return bad;
+    }
   
   hyperpoint tabled_inverses::get(ld ix, ld iy, ld iz, bool lazy) {
     ix *= PRECX-1;
@@ -117,19 +249,32 @@ EX namespace sn {
       int ay = iy, by = ay+1;
       int az = iz, bz = az+1;
       
+      #if CAP_SIMD
+      /* the three coordinates are interpolated at once, with the same operations as below */
+      const float *p = &get_int(ax, ay, az)[0];
+      const int dy = 3 * PRECX, dz = 3 * PRECX * PRECY;
+      ld wz0 = bz-iz, wz1 = iz-az, wy0 = by-iy, wy1 = iy-ay;
+      using simd::lincomb; using simd::load_floats3;
+      auto s00 = lincomb(load_floats3(p), wz0, load_floats3(p+dz), wz1);
+      auto s01 = lincomb(load_floats3(p+dy), wz0, load_floats3(p+dy+dz), wz1);
+      auto s10 = lincomb(load_floats3(p+3), wz0, load_floats3(p+3+dz), wz1);
+      auto s11 = lincomb(load_floats3(p+3+dy), wz0, load_floats3(p+3+dy+dz), wz1);
+      simd::store(&res[0], lincomb(lincomb(s00, wy0, s01, wy1), bx-ix, lincomb(s10, wy0, s11, wy1), ix-ax));
+      #else
       #define S0(x,y,z) get_int(x, y, z)[t]
       #define S1(x,y) (S0(x,y,az) * (bz-iz) + S0(x,y,bz) * (iz-az))
       #define S2(x) (S1(x,ay) * (by-iy) + S1(x,by) * (iy-ay))
   
       for(int t=0; t<3; t++)
         res[t] = S2(ax) * (bx-ix) + S2(bx) * (ix-ax);
+      #endif
       
       res[3] = 0;
       }
     
     return res;
     }
-  
+
   GLuint tabled_inverses::get_texture_id() {
     if(!toload) return texture_id;
   
@@ -153,7 +298,7 @@ EX namespace sn {
     auto xbuffer = new glvertex[PRECZ*PRECY*PRECX];
     
     for(int z=0; z<PRECZ*PRECY*PRECX; z++) {
-      auto& t = tab[z];
+      auto& t = data[z];
       xbuffer[z] = glhr::makevertex(t[0], t[1], t[2]);
       }
     
@@ -2780,6 +2925,13 @@ EX namespace nisot {
       shift(); sn::niht.fname = args();
       return 0;
       }
+    else if(argis("-geodesic-check")) {
+      PHASEFROM(2);
+      shift(); int samples = argi();
+      if(!sn::in()) println(hlog, "-geodesic-check: not in Solv/NIH");
+      else if(sn::get_tabled().validate(samples)) exit(1);
+      return 0;
+      }
     #endif
     else if(argis("-solgeo")) {
       geodesic_movement = true;
@@ -1621,81 +1621,175 @@ EX namespace patterns {
     }
   
 
-  cld compute_map_function(cell *c, int p, const string& formula) {
-    exp_parser ep;
-    ep.extra_params["p"] = p;
-
-    hyperpoint h = calc_relative_matrix(c, currentmap->gamestart(), C0) * C0;
-    ep.extra_params["x"] = h[0];
-    ep.extra_params["y"] = h[1];
-    ep.extra_params["z"] = h[2];
-    ep.extra_params["w"] = h[3];
-    ep.extra_params["z40"] = zebra40(c);
-    ep.extra_params["z3"] = zebra3(c);
-    ep.extra_params["ev"] = emeraldval(c);
-    ep.extra_params["fv50"] = fiftyval(c);
-    ep.extra_params["pa"] = polara50(c);
-    ep.extra_params["pb"] = polarb50(c);
-    ep.extra_params["pd"] = cdist50(c);
-    ep.extra_params["fu"] = fieldpattern::fieldval_uniq(c);
-    ep.extra_params["threecolor"] = pattern_threecolor(c);
-    ep.extra_params["chess"] = chessvalue(c);
-    ep.extra_params["ph"] = pseudohept(c);
-    ep.extra_params["kph"] = kraken_pseudohept(c);
-    if(true) {
-      ep.extra_params["md"] = c->master->distance;
-      ep.extra_params["me"] = c->master->emeraldval;
-      ep.extra_params["mf"] = c->master->fieldval;
-      ep.extra_params["mz"] = c->master->zebraval;
-      }
-
-    if(sphere) {
-      ep.extra_params["h0"] = getHemisphere(c, 0);
-      ep.extra_params["h1"] = getHemisphere(c, 1);
-      ep.extra_params["h2"] = getHemisphere(c, 2);
-      }
+  /** variables for canvas formulas, computed together (e.g., x, y, z, w all come from the same matrix) */
+  struct map_variables {
+    vector<string> names;
+    std::function<void(cell*, cld*)> compute;
+    };
+
+  /** the variables for canvas formulas available in the current geometry */
+  vector<map_variables> get_map_variables() {
+    vector<map_variables> res;
+    auto add = [&] (const vector<string>& names, const std::function<void(cell*, cld*)>& f) {
+      res.push_back(map_variables{names, f});
+      };
+    auto add1 = [&] (const string& name, const std::function<cld(cell*)>& f) {
+      add({name}, [f] (cell *c, cld *v) { v[0] = f(c); });
+      };
+
+    add({"x", "y", "z", "w"}, [] (cell *c, cld *v) {
+      hyperpoint h = calc_relative_matrix(c, currentmap->gamestart(), C0) * C0;
+      for(int i=0; i<4; i++) v[i] = h[i];
+      });
+    add1("z40", [] (cell *c) { return zebra40(c); });
+    add1("z3", [] (cell *c) { return zebra3(c); });
+    add1("ev", [] (cell *c) { return emeraldval(c); });
+    add1("fv50", [] (cell *c) { return fiftyval(c); });
+    add1("pa", [] (cell *c) { return polara50(c); });
+    add1("pb", [] (cell *c) { return polarb50(c); });
+    add1("pd", [] (cell *c) { return cdist50(c); });
+    add1("fu", [] (cell *c) { return fieldpattern::fieldval_uniq(c); });
+    add1("threecolor", [] (cell *c) { return pattern_threecolor(c); });
+    add1("chess", [] (cell *c) { return chessvalue(c); });
+    add1("ph", [] (cell *c) { return pseudohept(c); });
+    add1("kph", [] (cell *c) { return kraken_pseudohept(c); });
+    add1("md", [] (cell *c) { return c->master->distance; });
+    add1("me", [] (cell *c) { return c->master->emeraldval; });
+    add1("mf", [] (cell *c) { return c->master->fieldval; });
+    add1("mz", [] (cell *c) { return c->master->zebraval; });
+
+    if(sphere) for(int i=0; i<3; i++)
+      add1("h"+its(i), [i] (cell *c) { return getHemisphere(c, i); });
     if(euclid) {
-      auto co = euc2_coordinates(c);
-      int x = co.first, y = co.second;
-      ep.extra_params["ex"] = x;
-      ep.extra_params["ey"] = y;
-      if(S7 == 6) ep.extra_params["ez"] = -x-y;
+      vector<string> names = {"ex", "ey"};
+      if(S7 == 6) names.push_back("ez");
+      add(names, [] (cell *c, cld *v) {
+        auto co = euc2_coordinates(c);
+        int x = co.first, y = co.second;
+        v[0] = x; v[1] = y;
+        if(S7 == 6) v[2] = -x-y;
+        });
       }
     if(cryst) {
-      crystal::ldcoord co = crystal::get_ldcoord(c);
-      for(int i=0; i<crystal::MAXDIM; i++)
-        ep.extra_params["x"+its(i)] = co[i];
-      }
-    if(asonov::in()) {
+      vector<string> names;
+      for(int i=0; i<crystal::MAXDIM; i++) names.push_back("x"+its(i));
+      add(names, [] (cell *c, cld *v) {
+        crystal::ldcoord co = crystal::get_ldcoord(c);
+        for(int i=0; i<crystal::MAXDIM; i++) v[i] = co[i];
+        });
+      }
+    if(asonov::in()) add({"ax", "ay", "az"}, [] (cell *c, cld *v) {
       auto co = asonov::get_coord(c->master);
-      ep.extra_params["ax"] = szgmod(co[0], asonov::period_xy);
-      ep.extra_params["ay"] = szgmod(co[1], asonov::period_xy);
-      ep.extra_params["az"] = szgmod(co[2], asonov::period_z);      
-      }
-    if(nil) {
+      v[0] = szgmod(co[0], asonov::period_xy);
+      v[1] = szgmod(co[1], asonov::period_xy);
+      v[2] = szgmod(co[2], asonov::period_z);
+      });
+    if(nil) add({"nx", "ny", "nz"}, [] (cell *c, cld *v) {
       auto co = nilv::get_coord(c->master);
-      ep.extra_params["nx"] = szgmod(co[0], nilv::nilperiod[0]);
-      ep.extra_params["ny"] = szgmod(co[1], nilv::nilperiod[1]);
-      ep.extra_params["nz"] = szgmod(co[2], nilv::nilperiod[2]);      
-      }
+      for(int i=0; i<3; i++) v[i] = szgmod(co[i], nilv::nilperiod[i]);
+      });
     if(hybri)
-      ep.extra_params["level"] = hybrid::get_where(c).second;
+      add1("level", [] (cell *c) { return hybrid::get_where(c).second; });
+
+    if(geometry_supports_cdata()) for(int i=0; i<4; i++)
+      add1("d"+its(i), [i] (cell *c) { return getCdata(c, i); });
+
+    return res;
+    }
+
+  /** a canvas formula, compiled for the current geometry */
+  struct map_function {
+    string formula;
+    /** which variables were available when compiling */
+    int key;
+    vector<map_variables> variables;
+    /** the slot of the first variable of every group; slot 0 is p */
+    vector<int> first_slot;
+    /** should this group of variables be computed? */
+    vector<bool> needed;
+    /** the names of the slots, for the interpreted formulas */
+    vector<string> names;
+    vector<cld> slots;
+    compiled_formula f;
+    /** the formula could not be parsed */
+    bool invalid;
+    /** evaluate with exp_parser, since the formula uses something exp_compiler does not handle */
+    bool interpreted;
+    };
 
-    if(geometry_supports_cdata()) {
-      ep.extra_params["d0"] = getCdata(c, 0);
-      ep.extra_params["d1"] = getCdata(c, 1);
-      ep.extra_params["d2"] = getCdata(c, 2);
-      ep.extra_params["d3"] = getCdata(c, 3);
+  map_function current_map_function;
+
+  int map_function_key() {
+    int key = 0;
+    for(bool b: {sphere, euclid, euclid && S7 == 6, bool(cryst), asonov::in(), bool(nil), bool(hybri), geometry_supports_cdata()})
+      key = 2 * key + (b ? 1 : 0);
+    return key;
+    }
+
+  /** compile the formula, unless it is the one compiled last time */
+  map_function& get_map_function(const string& formula) {
+    auto& mf = current_map_function;
+    int key = map_function_key();
+    if(!mf.names.empty() && mf.formula == formula && mf.key == key) return mf;
+    mf = map_function();
+    mf.formula = formula;
+    mf.key = key;
+    mf.invalid = mf.interpreted = false;
+    mf.variables = get_map_variables();
+    mf.names = {"p"};
+    for(auto& mv: mf.variables) {
+      mf.first_slot.push_back(isize(mf.names));
+      for(auto& n: mv.names) mf.names.push_back(n);
+      }
+    exp_compiler ec(mf.names);
+    ec.s = formula;
+    try {
+      mf.f = ec.compile();
       }
-        
-    ep.s = formula;
+    catch(hr_uncompilable_exception& ex) {
+      mf.interpreted = true;
+      }
+    catch(hr_parse_exception& ex) {
+      mf.invalid = true;
+      }
+    mf.slots.resize(mf.interpreted ? isize(mf.names) : isize(ec.used));
+    for(int i=0; i<isize(mf.variables); i++) {
+      bool need = mf.interpreted;
+      for(int j=0; j<isize(mf.variables[i].names); j++)
+        if(!mf.interpreted && ec.used[mf.first_slot[i] + j]) need = true;
+      mf.needed.push_back(need);
+      }
+    return mf;
+    }
+
+  void compute_map_variables(map_function& mf, cell *c) {
+    if(mf.invalid) return;
+    for(int i=0; i<isize(mf.variables); i++)
+      if(mf.needed[i]) mf.variables[i].compute(c, &mf.slots[mf.first_slot[i]]);
+    }
+
+  cld eval_map_function(map_function& mf, int p) {
+    if(mf.invalid) return 0;
+    mf.slots[0] = p;
     try {
-      return ep.parse();
+      if(mf.interpreted) {
+        exp_parser ep;
+        for(int i=0; i<isize(mf.names); i++) ep.extra_params[mf.names[i]] = mf.slots[i];
+        ep.s = mf.formula;
+        return ep.parse();
+        }
+      return mf.f(&mf.slots[0]);
       }
     catch(hr_parse_exception& ex) {
       return 0;
       }
     }
+
+  cld compute_map_function(cell *c, int p, const string& formula) {
+    auto& mf = get_map_function(formula);
+    compute_map_variables(mf, c);
+    return eval_map_function(mf, p);
+    }
   
   EX hookset<int(cell*)> hooks_generate_canvas;
   
@@ -1870,8 +1964,10 @@ EX namespace patterns {
         }
       case 'f': {
         color_t res;
+        auto& mf = get_map_function(color_formula);
+        compute_map_variables(mf, c);
         for(int i=0; i<4; i++) {
-          ld v = real(compute_map_function(c, 1+i, color_formula));
+          ld v = real(eval_map_function(mf, 1+i));
           if(i == 3) part(res, i) = (v > 0);
           else if(v < 0) part(res, i) = 0;
           else if(v > 1) part(res, i) = 255;
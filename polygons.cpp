@@ -12,6 +12,15 @@ namespace hr {
 
 #if HDR
 static constexpr ld NEWSHAPE = (-13.5);
+
+inline void hwrite(hstream& hs, const hpcshape& sh) {
+  hwrite(hs, sh.s, sh.e, sh.prio, sh.flags, sh.intester, sh.texture_offset, sh.shs, sh.she);
+  }
+
+inline void hread(hstream& hs, hpcshape& sh) {
+  hread(hs, sh.s, sh.e, sh.prio, sh.flags, sh.intester, sh.texture_offset, sh.shs, sh.she);
+  sh.tinf = NULL;
+  }
 #endif
 static constexpr ld WOLF = (-15.5);
 
@@ -1138,6 +1147,224 @@ void geometry_information::configure_floorshapes() {
   generate_floorshapes();
   }
 
+/** \brief directory where the results of prepare_shapes are cached on disk, keyed by cgi_string(); empty to disable
+ *
+ *  Only 2D geometries are cached, and not the irregular, arb and fake ones, since their cgi_string() contains
+ *  a counter rather than a description of the tiling.
+ */
+EX string shape_cache_dir;
+
+/** \brief increase this when the format of the data saved by save_shapes changes */
+static const int SHAPE_CACHE_VERSION = 2;
+
+static const string shape_cache_magic = "HyperRogue shape cache";
+
+EX bool shape_cache_available() {
+  if(shape_cache_dir == "") return false;
+  if(GDIM != 2 || fake::in() || IRREGULAR || arb::in()) return false;
+  return true;
+  }
+
+string shape_cache_file() {
+  return shape_cache_dir + "/shapes-" + hr::format("%016llx", (unsigned long long) std::hash<string>()(cgi_string())) + ".dat";
+  }
+
+/** \brief add sh, or all the hpcshapes in an array of them, to res */
+void add_shapes(vector<hpcshape*>& res, hpcshape& sh) { res.push_back(&sh); }
+
+template<class T, size_t N> void add_shapes(vector<hpcshape*>& res, T (&arr)[N]) { for(auto& x: arr) add_shapes(res, x); }
+
+template<class T, size_t N> void add_shapes(vector<hpcshape*>& res, array<T, N>& arr) { for(auto& x: arr) add_shapes(res, x); }
+
+/** \brief list the hpcshapes which are members of this structure, and (if with_floorshapes) the hpcshapes of the floorshapes */
+void geometry_information::list_shapes(vector<hpcshape*>& res, bool with_floorshapes) {
+  res.clear();
+  #define LIST_HPCSHAPE(name, dims) add_shapes(res, name);
+  #define LIST_ANIMATED(name) add_shapes(res, name);
+  GEOMETRY_SHAPES(LIST_HPCSHAPE, LIST_ANIMATED)
+  #undef LIST_HPCSHAPE
+  #undef LIST_ANIMATED
+  add_shapes(res, shFullCross);
+  if(!with_floorshapes) return;
+  auto add_vector = [&] (vector<hpcshape>& v) { for(auto& sh: v) res.push_back(&sh); };
+  auto add_floorshape = [&] (floorshape *fsh) {
+    add_vector(fsh->b); add_vector(fsh->shadow);
+    for(int k=0; k<SIDEPARS; k++) {
+      add_vector(fsh->side[k]); add_vector(fsh->levels[k]);
+      for(auto& v: fsh->gpside[k]) add_vector(v);
+      }
+    for(int k=0; k<2; k++) add_vector(fsh->cone[k]);
+    };
+  for(auto fsh: all_plain_floorshapes) add_floorshape(fsh);
+  for(auto fsh: all_escher_floorshapes) add_floorshape(fsh);
+  }
+
+/** \brief save everything computed by prepare_shapes (in 2D); returns false if something cannot be saved */
+bool geometry_information::save_shapes(hstream& hs) {
+  vector<hpcshape*> shapes;
+  list_shapes(shapes, true);
+  map<hpcshape*, int> index;
+  for(int i=0; i<isize(shapes); i++) {
+    if(shapes[i]->tinf) return false;
+    index[shapes[i]] = i;
+    }
+
+  hwrite(hs, SD3, SD6, SD7, S12, S14, S21, S28, S36, S42, S84);
+  for(auto& x: asteroid_size) hwrite(hs, x);
+  hwrite(hs, corner_bonus, sword_size, wormscale, tentacle_length, prehpc, first);
+  for(int k=0; k<SIDEPARS; k++) hwrite(hs, dlow_table[k], dhi_table[k], dfloor_table[k], validsidepar[k]);
+  hwrite(hs, symmetriesAt, hpc);
+
+  auto write_floorshape = [&] (floorshape *fsh) {
+    hwrite(hs, fsh->is_plain, fsh->shapeid, fsh->id, fsh->pstrength, fsh->fstrength, fsh->prio, fsh->b, fsh->shadow);
+    for(int k=0; k<SIDEPARS; k++) hwrite(hs, fsh->side[k], fsh->levels[k], fsh->gpside[k]);
+    for(int k=0; k<2; k++) hwrite(hs, fsh->cone[k]);
+    };
+  for(auto fsh: all_plain_floorshapes) { hwrite(hs, fsh->rad0, fsh->rad1); write_floorshape(fsh); }
+  for(auto fsh: all_escher_floorshapes) { hwrite(hs, fsh->shapeid0, fsh->shapeid1, fsh->noftype, fsh->shapeid2, fsh->scale); write_floorshape(fsh); }
+
+  list_shapes(shapes, false);
+  for(auto sh: shapes) hwrite(hs, *sh);
+
+  hwrite<int>(hs, isize(allshapes));
+  for(auto sh: allshapes) hwrite<int>(hs, index.count(sh) ? index[sh] : -1);
+  return true;
+  }
+
+/** \brief the inverse of save_shapes */
+void geometry_information::load_shapes(hstream& hs) {
+  init_floorshapes();
+
+  hread(hs, SD3, SD6, SD7, S12, S14, S21, S28, S36, S42, S84);
+  for(auto& x: asteroid_size) hread(hs, x);
+  hread(hs, corner_bonus, sword_size, wormscale, tentacle_length, prehpc, first);
+  for(int k=0; k<SIDEPARS; k++) hread(hs, dlow_table[k], dhi_table[k], dfloor_table[k], validsidepar[k]);
+  hread(hs, symmetriesAt, hpc);
+
+  auto read_floorshape = [&] (floorshape *fsh) {
+    hread(hs, fsh->is_plain, fsh->shapeid, fsh->id, fsh->pstrength, fsh->fstrength, fsh->prio, fsh->b, fsh->shadow);
+    for(int k=0; k<SIDEPARS; k++) hread(hs, fsh->side[k], fsh->levels[k], fsh->gpside[k]);
+    for(int k=0; k<2; k++) hread(hs, fsh->cone[k]);
+    };
+  for(auto fsh: all_plain_floorshapes) { hread(hs, fsh->rad0, fsh->rad1); read_floorshape(fsh); }
+  for(auto fsh: all_escher_floorshapes) { hread(hs, fsh->shapeid0, fsh->shapeid1, fsh->noftype, fsh->shapeid2, fsh->scale); read_floorshape(fsh); }
+
+  vector<hpcshape*> shapes;
+  list_shapes(shapes, false);
+  for(auto sh: shapes) hread(hs, *sh);
+
+  list_shapes(shapes, true);
+  /* the shapes are saved with no textures (see save_shapes), and must stay within hpc */
+  auto in_hpc = [&] (int s, int e) { return s >= 0 && s <= e && e <= isize(hpc); };
+  if(prehpc < 0 || prehpc > isize(hpc)) throw hstream_exception();
+  for(auto sh: shapes) {
+    sh->tinf = nullptr;
+    if(!in_hpc(sh->s, sh->e) || !in_hpc(sh->shs, sh->she)) throw hstream_exception();
+    }
+
+  allshapes.resize(hs.get<int>());
+  for(auto& sh: allshapes) {
+    int i = hs.get<int>();
+    sh = i >= 0 && i < isize(shapes) ? shapes[i] : nullptr;
+    }
+  allshapes.erase(std::remove(allshapes.begin(), allshapes.end(), nullptr), allshapes.end());
+  last = NULL;
+  }
+
+/** \brief when this file was compiled */
+static const char *polygons_compiled = __DATE__ " " __TIME__;
+
+/** \brief the header of the cache file, which has to match exactly
+ *
+ *  Besides the format version, it includes the time when polygons.cpp and floorshapes.cpp were compiled,
+ *  so that the shapes cached by an older build are never used after the code computing them changes.
+ */
+string shape_cache_header() {
+  shstream ss;
+  hwrite(ss, shape_cache_magic, SHAPE_CACHE_VERSION, VERNUM_HEX, string(polygons_compiled), string(floorshapes_compiled));
+  hwrite(ss, int(sizeof(geometry_information)), int(sizeof(hpcshape)), int(sizeof(ld)), cgi_string());
+  return ss.s;
+  }
+
+/** \brief checksum (64-bit FNV-1a) of the given part of the cache file */
+unsigned long long shape_cache_checksum(const string& s, int from, int to) {
+  unsigned long long h = 14695981039346656037ull;
+  for(int i=from; i<to; i++) h = (h ^ (unsigned char) s[i]) * 1099511628211ull;
+  return h;
+  }
+
+/** \brief load the shapes from the disk cache, if available; the whole file is read and verified before anything is changed */
+bool geometry_information::load_cached_shapes() {
+  if(!shape_cache_available()) return false;
+  string fname = shape_cache_file();
+  FILE *f = fopen(fname.c_str(), "rb");
+  if(!f) return false;
+  string data;
+  char buf[1<<16];
+  while(true) {
+    size_t q = fread(buf, 1, sizeof(buf), f);
+    if(q == 0) break;
+    data.append(buf, q);
+    }
+  fclose(f);
+
+  /* the file consists of the header, the data saved by save_shapes, its checksum, and the magic string */
+  string header = shape_cache_header();
+  int sum_size = sizeof(unsigned long long);
+  if(isize(data) < isize(header) + sum_size + isize(shape_cache_magic) || data.compare(0, isize(header), header) || data.compare(isize(data) - isize(shape_cache_magic), isize(shape_cache_magic), shape_cache_magic)) {
+    DEBB(DF_POLY, ("shape cache: ignoring ", fname));
+    return false;
+    }
+  int payload_end = isize(data) - isize(shape_cache_magic) - sum_size;
+  unsigned long long sum;
+  memcpy(&sum, &data[payload_end], sum_size);
+  if(sum != shape_cache_checksum(data, isize(header), payload_end)) {
+    println(hlog, "shape cache: bad checksum in ", fname);
+    return false;
+    }
+
+  shstream ss(data);
+  ss.pos = isize(header);
+  try {
+    load_shapes(ss);
+    if(ss.pos != payload_end) throw hstream_exception();
+    }
+  catch(hstream_exception&) {
+    println(hlog, "shape cache: corrupt file ", fname);
+    /* prepare_shapes recomputes everything else, but it expects empty floorshapes */
+    for(auto fsh: all_plain_floorshapes) *fsh = plain_floorshape();
+    for(auto fsh: all_escher_floorshapes) *fsh = escher_floorshape();
+    return false;
+    }
+  DEBB(DF_POLY, ("shape cache: loaded ", fname));
+  initPolyForGL();
+  return true;
+  }
+
+/** \brief save the shapes to the disk cache; written to a temporary file (named after the pid, so that concurrent processes do not
+ *  write into the same one) first, and then renamed, so that the cache file is never seen partially written */
+void geometry_information::save_cached_shapes() {
+  if(!shape_cache_available()) return;
+  shstream ss;
+  ss.s = shape_cache_header();
+  int payload_start = isize(ss.s);
+  if(!save_shapes(ss)) return;
+  unsigned long long sum = shape_cache_checksum(ss.s, payload_start, isize(ss.s));
+  ss.s.append((const char*) &sum, sizeof(sum));
+  ss.s += shape_cache_magic;
+  string fname = shape_cache_file();
+  string tmpname = fname + "." + its(getpid()) + ".tmp";
+  FILE *f = fopen(tmpname.c_str(), "wb");
+  if(!f) {
+    DEBB(DF_POLY, ("shape cache: cannot write ", tmpname));
+    return;
+    }
+  bool ok = fwrite(ss.s.c_str(), isize(ss.s), 1, f) == 1;
+  ok = fclose(f) == 0 && ok;
+  if(ok) ok = rename(tmpname.c_str(), fname.c_str()) == 0;
+  if(!ok) remove(tmpname.c_str());
+  }
+
 void geometry_information::prepare_shapes() {
   require_basics();
   if(cgflags & qRAYONLY) return;
@@ -1147,6 +1374,8 @@ void geometry_information::prepare_shapes() {
 
   if(fake::in()) { FPIU( cgi.require_shapes() ); }
 
+  if(load_cached_shapes()) return;
+
   symmetriesAt.clear();
   allshapes.clear();
   DEBBI(DF_POLY, ("buildpolys"));
@@ -1614,8 +1843,18 @@ void geometry_information::prepare_shapes() {
   prehpc = isize(hpc);
 
   initPolyForGL();
+  save_cached_shapes();
   }
 
+#if CAP_COMMANDLINE
+auto shape_cache_hook = 
+  addHook(hooks_args, 100, [] () {
+    using namespace arg;
+    if(argis("-shape-cache")) { PHASEFROM(1); shift(); shape_cache_dir = args(); return 0; }
+    else return 1;
+    });
+#endif
+
 EX vector<long double> polydata = {
 // shStarFloor[0] (6x1)
 NEWSHAPE,   1,6,1, 0.267355,0.153145, 0.158858,0.062321, 0.357493,-0.060252,
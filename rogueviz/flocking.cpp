@@ -16,30 +16,6 @@
 
 // press 'o' when flocking active to change the parameters.
 
-#ifdef USE_THREADS
-#include <thread>
-int threads = 1;
-#endif
-
-template<class T> auto parallelize(long long N, T action) -> decltype(action(0,0)) {
-#ifndef USE_THREADS
-  return action(0,N);
-#else
-  if(threads == 1) return action(0,N);
-  std::vector<std::thread> v;
-  typedef decltype(action(0,0)) Res;
-  std::vector<Res> results(threads);
-  for(int k=0; k<threads; k++)
-    v.emplace_back([&,k] () { 
-      results[k] = action(N*k/threads, N*(k+1)/threads); 
-      });
-  for(std::thread& t:v) t.join();
-  Res res = 0;
-  for(Res r: results) res += r;
-  return res;
-#endif
-  }
-
 #include "rogueviz.h"
 
 namespace rogueviz {
@@ -55,7 +31,19 @@ namespace flocking {
   int follow = 0;
   string follow_names[3] = {"nothing", "specific boid", "center of mass"};
   
-  map<cell*, map<cell*, transmatrix>> relmatrices;
+  /** the cells of the (bounded) space, and their ids, i.e., positions in this vector */
+  vector<cell*> cells;
+  map<cell*, int> cell_id;
+
+  /** the cells within check_range of the cell with id i are nbr_cell[nbr_start[i]] .. nbr_cell[nbr_start[i+1]-1];
+   *  nbr_matrix[k] is the matrix we have to multiply by to change from nbr_cell[k]-relative coordinates
+   *  to i-relative coordinates */
+  vector<int> nbr_start, nbr_cell;
+  vector<transmatrix> nbr_matrix;
+
+  /** boids_at[i] lists the boids on the cell with id i; boid j is boids_at[boid_cell[j]][boid_slot[j]] */
+  vector<vector<int>> boids_at;
+  vector<int> boid_cell, boid_slot;
 
   ld ini_speed = .5;
   ld max_speed = 1;
@@ -94,9 +82,12 @@ namespace flocking {
     
     const auto v = currentmap->allcells();
     
+    cells = v;
+    cell_id.clear();
+    for(int i=0; i<isize(cells); i++) cell_id[cells[i]] = i;
+    
     printf("computing relmatrices...\n");
-    // relmatrices[c1][c2] is the matrix we have to multiply by to 
-    // change from c1-relative coordinates to c2-relative coordinates
+    nbr_start = {0}; nbr_cell.clear(); nbr_matrix.clear();
     for(cell* c1: v) {
       manual_celllister cl;
       cl.add(c1);
@@ -104,11 +95,16 @@ namespace flocking {
         cell *c2 = cl.lst[i];
         transmatrix T = calc_relative_matrix(c2, c1, C0);
         if(hypot_d(WDIM, inverse_exp(shiftless(tC0(T)))) <= check_range) {
-          relmatrices[c1][c2] = T;
+          nbr_cell.push_back(cell_id.at(c2));
+          nbr_matrix.push_back(T);
           forCellEx(c3, c2) cl.add(c3);
           }
         }
+      nbr_start.push_back(isize(nbr_cell));
       }
+    
+    boids_at.clear(); boids_at.resize(isize(cells));
+    boid_cell.clear(); boid_slot.clear();
 
     printf("setting up...\n");
     for(int i=0; i<N; i++) {
@@ -131,6 +127,23 @@ namespace flocking {
   
   int precision = 10;
   
+  /** move boid j to the list of its current cell, if it has changed */
+  void place_boid(int j) {
+    int& id = boid_cell[j];
+    cell *c = vdata[j].m->base;
+    if(id >= 0 && cells[id] == c) return;
+    if(id >= 0) {
+      auto& b = boids_at[id];
+      int last = b.back();
+      b[boid_slot[j]] = last;
+      boid_slot[last] = boid_slot[j];
+      b.pop_back();
+      }
+    id = cell_id.at(c);
+    boid_slot[j] = isize(boids_at[id]);
+    boids_at[id].push_back(j);
+    }
+  
   void simulate(int delta) {
     int iter = 0;
     while(delta > precision && iter < 100) { 
@@ -142,19 +155,18 @@ namespace flocking {
     vector<transmatrix> pats(N);
     vector<transmatrix> oris(N);
     vector<ld> vels(N);
-    using shmup::monster;
     
-    map<cell*, vector<monster*>> monsat;
-
-    for(int i=0; i<N; i++) {
-      vertexdata& vd = vdata[i];
-      auto m = vd.m;
-      monsat[m->base].push_back(m);
+    if(isize(boid_cell) != N) {
+      for(auto& b: boids_at) b.clear();
+      boid_cell.assign(N, -1);
+      boid_slot.assign(N, 0);
+      for(int i=0; i<N; i++) place_boid(i);
       }
     
     lines.clear();
 
-    parallelize(N, [&monsat, &d, &vels, &pats, &oris] (int a, int b) { for(int i=a; i<b; i++) {
+    // the lines are collected in a shared vector, so only one thread is used when they are drawn
+    parallel_for(N, [&d, &vels, &pats, &oris] (int a, int b) { for(int i=a; i<b; i++) {
       vertexdata& vd = vdata[i];
       auto m = vd.m;
       
@@ -189,11 +201,15 @@ namespace flocking {
       hyperpoint coh = hpxyz(0, 0, 0);
       int coh_count = 0;
       
-      for(auto& p: relmatrices[m->base]) {
-        auto f = monsat.find(p.first);
-        if(f != monsat.end()) for(auto m2: f->second) if(m != m2) {
+      int id = boid_cell[i];
+      for(int k=nbr_start[id]; k<nbr_start[id+1]; k++) {
+        auto& near = boids_at[nbr_cell[k]];
+        if(near.empty()) continue;
+        transmatrix T = I * nbr_matrix[k];
+        for(int j: near) if(j != i) {
+          auto m2 = vdata[j].m;
           ld vel2 = m2->vel;
-          transmatrix at2 = I * p.second * m2->at;
+          transmatrix at2 = T * m2->at;
 
           // at2 is like m2->at but relative to m->at
           
@@ -265,7 +281,7 @@ namespace flocking {
         oris[i] = spin(+atan2(h[1], h[0])) * oris[i];
         }
       
-      } return 0; });
+      } }, draw_lines ? 1 : 0);
       
     for(int i=0; i<N; i++) {
       vertexdata& vd = vdata[i];
@@ -275,6 +291,7 @@ namespace flocking {
       m->ori = oris[i];
       virtualRebase(m);
       m->vel = vels[i];
+      place_boid(i);
       }
     shmup::fixStorage();
     
@@ -392,11 +409,6 @@ namespace flocking {
       shift(); ini_speed = argf();
       shift(); max_speed = argf();
       }
-    #ifdef USE_THREADS
-    else if(argis("-threads")) {
-      shift(); threads = argi();
-      }
-    #endif
     else return 1;
     return 0;
     }
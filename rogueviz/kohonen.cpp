@@ -126,14 +126,111 @@ int qpct = 100;
 int t, lpct, cells;
 double maxdist;
 
-neuron& winner(int id) {
-  double bdiff = HUGE_VAL;
-  neuron *bcell = NULL;
-  for(neuron& n: net) {
-    double diff = vnorm(n.net, data[id].val);
-    if(diff < bdiff) bdiff = diff, bcell = &n;
+/** \brief the search for the best matching unit
+ *
+ *  The neuron vectors, multiplied by the column weights, are kept in one contiguous matrix,
+ *  with the rows padded to a multiple of 4 columns, so that the distances are computed with SIMD.
+ *  Large networks are searched in parallel, using the thread pool (-threads). step() updates
+ *  the rows it changes; after any other change to the network or weights, call bmu::invalidate().
+ */
+namespace bmu {
+  int stride;
+  vector<double> matrix;
+  bool valid = false;
+
+  void invalidate() { valid = false; }
+
+  void set_row(int i) {
+    double *r = &matrix[i * stride];
+    for(int k=0; k<columns; k++) r[k] = net[i].net[k] * weights[k];
+    }
+
+  void update_row(int i) { if(valid) set_row(i); }
+
+  void rebuild() {
+    stride = (columns + 3) & ~3;
+    matrix.assign(cells * stride, 0);
+    for(int i=0; i<cells; i++) set_row(i);
+    valid = true;
+    }
+
+  /** v multiplied by the column weights and padded, as in the matrix */
+  void weigh(const kohvec& v, vector<double>& res) {
+    res.assign(stride, 0);
+    for(int k=0; k<columns; k++) res[k] = v[k] * weights[k];
+    }
+
+  /** squared distance between two padded rows; equal to vnorm up to rounding */
+  inline double distance(const double *a, const double *b) {
+    #if CAP_SIMD && defined(__AVX__)
+    __m256d acc = _mm256_setzero_pd();
+    for(int k=0; k<stride; k+=4) {
+      __m256d d = _mm256_sub_pd(_mm256_loadu_pd(a+k), _mm256_loadu_pd(b+k));
+      acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+      }
+    double r[4];
+    _mm256_storeu_pd(r, acc);
+    return (r[0] + r[1]) + (r[2] + r[3]);
+    #elif CAP_SIMD
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    for(int k=0; k<stride; k+=4) {
+      __m128d d0 = _mm_sub_pd(_mm_loadu_pd(a+k), _mm_loadu_pd(b+k));
+      __m128d d1 = _mm_sub_pd(_mm_loadu_pd(a+k+2), _mm_loadu_pd(b+k+2));
+      acc0 = _mm_add_pd(acc0, _mm_mul_pd(d0, d0));
+      acc1 = _mm_add_pd(acc1, _mm_mul_pd(d1, d1));
+      }
+    double r[4];
+    _mm_storeu_pd(r, acc0); _mm_storeu_pd(r+2, acc1);
+    return (r[0] + r[2]) + (r[1] + r[3]);
+    #else
+    double acc[4] = {0, 0, 0, 0};
+    for(int k=0; k<stride; k+=4)
+      for(int j=0; j<4; j++) acc[j] += sqr(a[k+j] - b[k+j]);
+    return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    #endif
+    }
+
+  /** the closest neuron among [from, to) to the padded row s, and the distance; the first one in case of ties */
+  pair<double, int> search(const double *s, int from, int to) {
+    pair<double, int> best(HUGE_VAL, -1);
+    const double *r = &matrix[from * stride];
+    for(int i=from; i<to; i++, r += stride) {
+      double diff = distance(r, s);
+      if(diff < best.first) best = make_pair(diff, i);
+      }
+    return best;
+    }
+
+  /** the best matching unit for v, splitting the neurons between threads when there is enough work */
+  pair<double, int> find(const kohvec& v) {
+    if(!valid) rebuild();
+    static vector<double> s;
+    weigh(v, s);
+    int chunks = (long long) cells * stride >= (1<<16) ? thread_count() : 1;
+    if(chunks == 1) return search(&s[0], 0, cells);
+    vector<pair<double, int>> res(chunks);
+    parallel_chunks(chunks, [&] (int k) { res[k] = search(&s[0], cells * (long long) k / chunks, cells * (long long) (k+1) / chunks); });
+    pair<double, int> best = res[0];
+    for(auto& r: res) if(r.first < best.first) best = r;
+    return best;
+    }
+
+  /** the best matching units of all the samples, computed in parallel */
+  void find_all(vector<pair<double, int>>& res) {
+    if(!valid) rebuild();
+    res.resize(samples);
+    parallel_for(samples, [&] (int from, int to) {
+      vector<double> s;
+      for(int id=from; id<to; id++) {
+        weigh(data[id].val, s);
+        res[id] = search(&s[0], 0, cells);
+        }
+      });
     }
-  return *bcell;
+  }
+
+neuron& winner(int id) {
+  return net[bmu::find(data[id].val).second];
   }
 
 void setindex(bool b) {
@@ -513,6 +610,49 @@ int krad;
 
 double ttpower = 1;
 
+/** the number of epochs of the batch training; 0 to train on one sample at a time */
+int batch_epochs = 0;
+
+/** one epoch of the batch training: every neuron becomes the average of all the samples,
+ *  weighted by the neighborhood function around their best matching units */
+void batch_step(double sigma, int dispid) {
+  vector<pair<double, int>> bmus;
+  bmu::find_all(bmus);
+  whowon.resize(samples);
+
+  vector<double> sum(cells * columns, 0), count(cells, 0);
+  for(int id=0; id<samples; id++) {
+    int i = bmus[id].second;
+    whowon[id] = &net[i];
+    count[i]++;
+    for(int k=0; k<columns; k++) sum[i * columns + k] += data[id].val[k];
+    }
+
+  vector<double> num(cells * columns, 0), den(cells, 0);
+  for(int i=0; i<cells; i++) if(count[i]) {
+    auto cid = get_cellcrawler_id(net[i].where);
+    cellcrawler& s = scc[cid.first];
+    s.sprawl(cellwalker(net[i].where, cid.second));
+
+    vector<double> fake(1,1);
+    auto it = gaussian ? fake.begin() : s.dispersion[dispid].begin();
+
+    for(auto& sd: s.data) {
+      neuron *n2 = getNeuron(sd.target.at);
+      if(!n2) continue;
+      double h = gaussian ? exp(-sqr(sd.dist/sigma)) : *(it++);
+      int j = neuronId(*n2);
+      den[j] += h * count[i];
+      for(int k=0; k<columns; k++) num[j * columns + k] += h * sum[i * columns + k];
+      }
+    }
+
+  for(int j=0; j<cells; j++) if(den[j] > 0) {
+    for(int k=0; k<columns; k++) net[j].net[k] = num[j * columns + k] / den[j];
+    bmu::update_row(j);
+    }
+  }
+
 void step() {
 
   if(t == 0) return;
@@ -537,6 +677,13 @@ void step() {
         printf("t = %6d/%6d %3d%% dispid=%5d maxudist=%10.7lf\n", t, tmax, pct, dispid, maxudist);
       }
     }
+  if(batch_epochs) {
+    batch_step(sigma, dispid);
+    t = max(t - max(tmax / batch_epochs, 1), 0);
+    if(t == 0) analyze();
+    return;
+    }
+
   int id = hrand(samples);
   neuron& n = winner(id);
   whowon.resize(samples);
@@ -572,6 +719,7 @@ void step() {
 
     for(int k=0; k<columns; k++)
       n2->net[k] += nu * (data[id].val[k] - n2->net[k]);
+    bmu::update_row(neuronId(*n2));
     }
   
   t--;
@@ -681,6 +829,7 @@ void sominit(int initto, bool load_compressed) {
   
     cells = isize(allcells);
     net.resize(cells);
+    bmu::invalidate();
     for(int i=0; i<cells; i++) net[i].where = allcells[i], allcells[i]->landparam = i;
     for(int i=0; i<cells; i++) {
       net[i].where->land = laCanvas;
@@ -932,6 +1081,7 @@ void kload(const string& fname) {
   for(neuron& n: net) {
     for(int k=0; k<columns; k++) if(!scan(f, n.net[k])) return;
     }
+  bmu::invalidate();
   analyze();
   }
 
@@ -975,6 +1125,7 @@ void kloadw(const string& fname) {
     nexti: ;
     }
   fclose(f);
+  bmu::invalidate();
   analyze();
   }
 
@@ -1018,14 +1169,10 @@ void do_classify() {
     printf("Classifying...\n");
     bids.resize(samples, 0);
     bdiffs.resize(samples, 1e20);
-    for(int s=0; s<samples; s++) {
-      for(int n=0; n<cells; n++) {
-        double diff = vnorm(net[n].net, data[s].val);
-        if(diff < bdiffs[s]) bdiffs[s] = diff, bids[s] = n, whowon[s] = &net[n];
-        }
-      if(!(s % 128))
-        progress("Classifying: " + its(s) + "/" + its(samples));
-      }
+    vector<pair<double, int>> bmus;
+    bmu::find_all(bmus);
+    for(int s=0; s<samples; s++)
+      bdiffs[s] = bmus[s].first, bids[s] = bmus[s].second;
     }
   if(bdiffs.empty()) {
     printf("Computing distances...\n");
@@ -1305,6 +1452,7 @@ void load_compressed(string name) {
   for(neuron& n: net)
     for(int k=0; k<columns; k++) 
       n.net[k] = f.get_raw<float>();
+  bmu::invalidate();
   // load data
   samples = f.get<int>();
   data.resize(samples);
@@ -1396,6 +1544,9 @@ int readArgs() {
     shift(); t = (t*1./tmax) * argi();
     tmax = argi();
     }
+  else if(argis("-sombatch")) {
+    shift(); batch_epochs = argi();
+    }
   else if(argis("-somlearn")) {
     // this one can be changed at any moment
     shift_arg_formula(learning_factor);
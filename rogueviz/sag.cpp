@@ -30,6 +30,16 @@ namespace sag {
   int sdist[MAXSNAKETAB][MAXSNAKETAB];
   int insnaketab = 0;
 
+  /* in bounded geometries, the distances between all the positions are computed in initSnake
+   * and kept in snakematrix, if it fits in snake_matrix_mb megabytes (-sagmatrix); otherwise
+   * initSnake computes hub labels, from which snakedist obtains the distance in a few microseconds */
+  int snake_matrix_mb = 256;
+  vector<unsigned char> snakematrix;
+
+  /** hub_labels[i] lists the (rank of hub, distance from i) pairs, sorted by rank; any two positions
+   *  have a common hub on a shortest path between them (pruned landmark labeling) */
+  vector<vector<pair<int, int>>> hub_labels;
+
   vector<cell*> snakecells;
   vector<int> snakefirst, snakelast;
   vector<int> snakenode;
@@ -61,9 +71,24 @@ namespace sag {
     
   void disable_snake() { if(snake_enabled) snakeswitch(); }
     
+  /** the distance between positions i and j according to hub_labels; numsnake if they are not connected */
+  int hub_distance(int i, int j) {
+    auto& a = hub_labels[i];
+    auto& b = hub_labels[j];
+    int best = numsnake;
+    int x = 0, y = 0;
+    while(x < isize(a) && y < isize(b)) {
+      if(a[x].first < b[y].first) x++;
+      else if(a[x].first > b[y].first) y++;
+      else { best = min(best, a[x].second + b[y].second); x++; y++; }
+      }
+    return best;
+    }
+
   int snakedist(int i, int j) {
     if(i < insnaketab && j < insnaketab) return sdist[i][j];
-    if(bounded) return celldistance(snakecells[i], snakecells[j]);
+    if(!snakematrix.empty()) return snakematrix[i * (size_t) numsnake + j];
+    if(!hub_labels.empty()) return hub_distance(i, j);
     int i0 = i, i1 = i, j0 = j, j1 = j;
     int cost = 0;
     // intersect
@@ -75,8 +100,91 @@ namespace sag {
       else return cost;
       }
     }
+
+  /** the table of all the distances in a bounded geometry, computed by BFS from every position; false if the diameter does not fit in a byte */
+  bool build_matrix(const vector<int>& adjstart, const vector<int>& adj) {
+    vector<unsigned char> m((size_t) numsnake * numsnake, 255);
+    std::atomic<bool> too_far(false);
+    parallel_for(numsnake, [&] (int from, int to) {
+      vector<int> q(numsnake);
+      for(int s=from; s<to; s++) {
+        unsigned char *d = &m[s * (size_t) numsnake];
+        int qa = 0, qb = 0;
+        d[s] = 0; q[qb++] = s;
+        while(qa < qb) {
+          int i = q[qa++];
+          if(d[i] >= 254) { too_far = true; break; }
+          for(int a=adjstart[i]; a<adjstart[i+1]; a++)
+            if(d[adj[a]] == 255) d[adj[a]] = d[i] + 1, q[qb++] = adj[a];
+          }
+        if(qb < numsnake) too_far = true;
+        }
+      });
+    if(!too_far) swap(snakematrix, m);
+    return !too_far;
+    }
+
+  /** pruned landmark labeling: a BFS from every position, in a random order, which stops at the positions whose
+   *  distance is already given by the earlier hubs; hence the labels stay short (about 100 hubs for 16K positions on a torus) */
+  void build_hub_labels(const vector<int>& adjstart, const vector<int>& adj) {
+    hub_labels.assign(numsnake, {});
+    vector<int> order(numsnake);
+    for(int i=0; i<numsnake; i++) order[i] = i;
+    /* not hrand, so that the labels do not change the later random choices */
+    std::mt19937 gen(1);
+    for(int i=numsnake-1; i>0; i--) swap(order[i], order[gen() % (i+1)]);
+    vector<int> dist(numsnake, -1), hubdist(numsnake, -1), q(numsnake);
+    for(int k=0; k<numsnake; k++) {
+      int r = order[k];
+      for(auto& h: hub_labels[r]) hubdist[h.first] = h.second;
+      int qa = 0, qb = 0;
+      dist[r] = 0; q[qb++] = r;
+      while(qa < qb) {
+        int i = q[qa++];
+        bool known = false;
+        for(auto& h: hub_labels[i])
+          if(hubdist[h.first] >= 0 && hubdist[h.first] + h.second <= dist[i]) { known = true; break; }
+        if(known) continue;
+        hub_labels[i].emplace_back(k, dist[i]);
+        for(int a=adjstart[i]; a<adjstart[i+1]; a++)
+          if(dist[adj[a]] < 0) dist[adj[a]] = dist[i] + 1, q[qb++] = adj[a];
+        }
+      for(int i=0; i<qb; i++) dist[q[i]] = -1;
+      for(auto& h: hub_labels[r]) hubdist[h.first] = -1;
+      }
+    }
+
+  /** prepare snakedist for a bounded geometry: the matrix if it fits in snake_matrix_mb, hub labels otherwise */
+  void build_distances() {
+    vector<int> adjstart(numsnake+1, 0), adj;
+    for(int i=0; i<numsnake; i++) {
+      cell *c = snakecells[i];
+      for(int k=0; k<c->type; k++) {
+        cell *c2 = c->move(k);
+        if(c2 && c2->wparam == INSNAKE) adj.push_back(c2->landparam);
+        }
+      adjstart[i+1] = isize(adj);
+      }
+    int t1 = SDL_GetTicks();
+    if((size_t) numsnake * numsnake <= (size_t) snake_matrix_mb << 20) {
+      if(build_matrix(adjstart, adj)) {
+        println(hlog, "snake distances: ", numsnake, "x", numsnake, " matrix built in ", SDL_GetTicks() - t1, " ms");
+        return;
+        }
+      println(hlog, "snake distances: matrix skipped, some distance over 253");
+      }
+    else
+      println(hlog, "snake distances: matrix skipped, it would take ", int(((size_t) numsnake * numsnake) >> 20), " MB (-sagmatrix ", snake_matrix_mb, ")");
+    t1 = SDL_GetTicks();
+    build_hub_labels(adjstart, adj);
+    size_t total = 0;
+    for(auto& l: hub_labels) total += l.size();
+    println(hlog, "snake distances: hub labels built in ", SDL_GetTicks() - t1, " ms, ", total * 1. / numsnake, " hubs per position");
+    }
   
   void initSnake(int n) {
+    snakematrix.clear();
+    hub_labels.clear();
     if(bounded) n = isize(currentmap->allcells());
     numsnake = n;
     snakecells.resize(numsnake);
@@ -108,6 +216,8 @@ namespace sag {
         setsnake(cw, i); cw += 1;
         }
       }
+    insnaketab = 0;
+    if(bounded) build_distances();
     int stab = min(numsnake, MAXSNAKETAB);
     for(int i=0; i<stab; i++)
     for(int j=0; j<stab; j++)
@@ -159,37 +269,44 @@ namespace sag {
     return false;
     }
 
-  void saiter() {
+  /** choose a vertex t1 and the position sid2 to move it to, in the layout given by ids; rnd(n) is a random number in [0,n) */
+  template<class R> bool propose(const vector<int>& ids, R&& rnd, int& t1, int& sid2) {
     aiter:
 
-    int t1 = hrand(N);
-    int sid1 = snakeid[t1];
-    
-    int sid2;
+    t1 = rnd(N);
+    int sid1 = ids[t1];
     
-    int s = hrand(6);
+    int s = rnd(6);
     
     if(s == 3) s = 2;
     if(s == 4) s = 5;
     
-    if((sagpar&1) && (s == 2 || s == 3 || s == 4)) return;
+    if((sagpar&1) && (s == 2 || s == 3 || s == 4)) return false;
     
-    if(s == 5) sid2 = hrand(numsnake);
+    if(s == 5) sid2 = rnd(numsnake);
     
     else {
       cell *c;
-      if(s>=2 && isize(vdata[t1].edges)) c = snakecells[snakeid[hrand(isize(vdata[t1].edges))]];
+      auto& edges = vdata[t1].edges;
+      if(s>=2 && isize(edges)) c = snakecells[ids[edges[rnd(isize(edges))].first]];
       else c = snakecells[sid1];
       
       int it = s<2 ? (s+1) : s-2;
       for(int ii=0; ii<it; ii++) {
-        int d = hrand(c->type);
+        int d = rnd(c->type);
         c = c->move(d);
         if(!c) goto aiter;
         if(c->wparam != INSNAKE) goto aiter;
         }
       sid2 = c->landparam;
       }
+    return true;
+    }
+
+  void saiter() {
+    int t1, sid2;
+    if(!propose(snakeid, [] (int n) { return hrand(n); }, t1, sid2)) return;
+    int sid1 = snakeid[t1];
     int t2 = snakenode[sid2];
     
     snakenode[sid1] = -1; snakeid[t1] = -1;
@@ -241,6 +358,16 @@ namespace sag {
     cost = 0; for(int i=0; i<N; i++) cost += costat(i, i);
     }
   
+  /** move all the vertices to their positions in snakeid */
+  void relocate() {
+    for(int i=0; i<N; i++) {
+      if(vdata[i].m) vdata[i].m->base = snakecells[sag::snakeid[i]];
+      forgetedges(i);
+      }
+
+    shmup::fixStorage();
+    }
+  
   void loadsnake(const string& fname) {
     printf("Loading the sag from: %s\n", fname.c_str());
     FILE *sf = fopen(fname.c_str(), "rt");
@@ -269,12 +396,7 @@ namespace sag {
     if(sf) fclose(sf);
 
     organize();
-    for(int i=0; i<N; i++) {
-      if(vdata[i].m) vdata[i].m->base = snakecells[sag::snakeid[i]];
-      forgetedges(i);
-      }
-
-    shmup::fixStorage();
+    relocate();
     }
   
   vector<edgeinfo> sagedges;
@@ -342,12 +464,147 @@ namespace sag {
       (double) sag::cost));
     }
   
-  void savesnake(const string& fname) {
+  void savesnake(const string& fname, const vector<int>& ids = snakeid) {
     FILE *f = fopen(fname.c_str(), "wt");
     for(int i=0; i<N; i++)
-      fprintf(f, "%s;%d\n", vdata[i].name.c_str(), snakeid[i]);
+      fprintf(f, "%s;%d\n", vdata[i].name.c_str(), ids[i]);
     fclose(f);
     }
+
+  /* parallel tempering: several replicas of the layout are annealed at once, each at its own
+   * temperature, in the threads of the core pool (-threads); after every round of pt_iterations
+   * iterations, the layouts of the replicas at neighboring temperatures may be exchanged */
+
+  int pt_iterations = 10000;
+
+  /** where to save the best layout found by the parallel tempering so far (empty: do not save) */
+  string checkpoint_fname;
+  int checkpoint_interval = 60;
+
+  struct replica {
+    vector<int> snakeid, snakenode;
+    /** vcost[v] is the cost of the edges of v in this layout, as in costat */
+    vector<double> vcost;
+    double cost;
+    ld temperature;
+    std::mt19937 gen;
+    int rand(int n) { return gen() % n; }
+    bool chance(double p) { return (gen() + .5) / (gen.max() + 1.) < p; }
+    };
+
+  /** the cost of the edges of vid at the position sid in the layout ids; the edges to skip are not counted, and their total weight is added to wskip */
+  double costat_in(const vector<int>& ids, int vid, int sid, int skip, double& wskip) {
+    double cost = 0;
+    vertexdata& vd = vdata[vid];
+    for(int j=0; j<isize(vd.edges); j++) {
+      edgeinfo *ei = vd.edges[j].second;
+      int t2 = vd.edges[j].first;
+      if(t2 == skip) wskip += ei->weight2;
+      else if(ids[t2] != -1) cost += snakedist(sid, ids[t2]) * ei->weight2;
+      }
+    return cost;
+    }
+
+  void init_replica(replica& r, ld temp) {
+    r.snakeid = snakeid; r.snakenode = snakenode;
+    r.vcost.resize(N);
+    r.cost = 0;
+    double w = 0;
+    for(int i=0; i<N; i++) r.cost += r.vcost[i] = costat_in(r.snakeid, i, r.snakeid[i], -1, w);
+    r.temperature = temp;
+    r.gen.seed(hrngen());
+    }
+
+  /** one iteration of SA on r; as saiter, but only the edges of the vertices moved are visited, and the costs of their neighbors are updated */
+  void replica_iter(replica& r) {
+    int t1, sid2;
+    if(!propose(r.snakeid, [&r] (int n) { return r.rand(n); }, t1, sid2)) return;
+    int sid1 = r.snakeid[t1];
+    if(sid1 == sid2) return;
+    int t2 = r.snakenode[sid2];
+
+    double w12 = 0, w21 = 0;
+    double new1 = costat_in(r.snakeid, t1, sid2, t2, w12);
+    double new2 = t2 >= 0 ? costat_in(r.snakeid, t2, sid1, t1, w21) : 0;
+    /* the edges between t1 and t2 have the same length after the swap */
+    double d12 = snakedist(sid1, sid2) * w12;
+    double change = new1 + new2 - (r.vcost[t1] - d12) - (t2 >= 0 ? r.vcost[t2] - d12 : 0);
+
+    if(change > 0 && !r.chance(exp(-change * exp(-r.temperature)))) return;
+
+    for(auto& e: vdata[t1].edges) {
+      int u = e.first;
+      if(u == t2 || r.snakeid[u] == -1) continue;
+      r.vcost[u] += (snakedist(r.snakeid[u], sid2) - snakedist(r.snakeid[u], sid1)) * e.second->weight2;
+      }
+    if(t2 >= 0) for(auto& e: vdata[t2].edges) {
+      int u = e.first;
+      if(u == t1 || r.snakeid[u] == -1) continue;
+      r.vcost[u] += (snakedist(r.snakeid[u], sid1) - snakedist(r.snakeid[u], sid2)) * e.second->weight2;
+      }
+    r.vcost[t1] = new1 + d12;
+    if(t2 >= 0) r.vcost[t2] = new2 + d12;
+
+    r.snakenode[sid1] = t2; r.snakenode[sid2] = t1;
+    r.snakeid[t1] = sid2; if(t2 >= 0) r.snakeid[t2] = sid1;
+    r.cost += 2*change;
+    }
+
+  /** run the parallel tempering with the given number of replicas for satime seconds, at the temperatures from hightemp to lowtemp */
+  void dopartemp(int replicas, int satime) {
+    enable_snake();
+    vector<replica> reps(replicas);
+    for(int i=0; i<replicas; i++)
+      init_replica(reps[i], replicas == 1 ? lowtemp : hightemp + (lowtemp - hightemp) * i / (replicas - 1.));
+
+    vector<int> best = snakeid;
+    double bestcost = reps[0].cost;
+    int chunks = min(replicas, thread_count());
+    int t1 = SDL_GetTicks(), last_checkpoint = t1;
+    int exchanges = 0, exchanges_tried = 0;
+
+    for(int round=0;; round++) {
+      int t2 = SDL_GetTicks();
+      if(t2 - t1 > 1000 * satime) break;
+
+      parallel_for(replicas, [&] (int a, int b) {
+        for(int i=a; i<b; i++) for(int it=0; it<pt_iterations; it++) replica_iter(reps[i]);
+        }, chunks);
+      numiter += replicas * pt_iterations;
+
+      for(auto& r: reps) {
+        /* recompute the total to avoid accumulating rounding errors */
+        r.cost = 0; for(double c: r.vcost) r.cost += c;
+        if(r.cost < bestcost) bestcost = r.cost, best = r.snakeid;
+        }
+
+      for(int i=round&1; i+1<replicas; i+=2) {
+        auto& r1 = reps[i];
+        auto& r2 = reps[i+1];
+        double delta = (exp(-r1.temperature) - exp(-r2.temperature)) * (r1.cost - r2.cost) / 2;
+        exchanges_tried++;
+        if(delta >= 0 || chance(exp(delta))) {
+          exchanges++;
+          swap(r1.snakeid, r2.snakeid); swap(r1.snakenode, r2.snakenode);
+          swap(r1.vcost, r2.vcost); swap(r1.cost, r2.cost);
+          }
+        }
+
+      DEBB(DF_LOG, (format("it %8d best cost = %f coldest = %f exchanges = %d/%d",
+        numiter, bestcost, reps.back().cost, exchanges, exchanges_tried)));
+
+      if(checkpoint_fname != "" && t2 >= last_checkpoint + 1000 * checkpoint_interval) {
+        savesnake(checkpoint_fname, best);
+        last_checkpoint = t2;
+        }
+      }
+
+    if(checkpoint_fname != "") savesnake(checkpoint_fname, best);
+    snakeid = best;
+    organize();
+    disable_snake();
+    relocate();
+    }
   
   void loglik() {
     int indist[30], pedge[30];
@@ -500,6 +757,10 @@ int readArgs() {
     shift_arg_formula(sag::edgepower);
     shift_arg_formula(sag::edgemul);
     }
+// (1) the largest matrix of distances, in megabytes; hub labels are used for larger bounded snakes
+  else if(argis("-sagmatrix")) {
+    shift(); sag::snake_matrix_mb = argi();
+    }
 // (1) configure temperature (high, low)
   else if(argis("-sagtemp")) {
     shift(); sag::hightemp = argi();
@@ -523,6 +784,20 @@ int readArgs() {
   else if(argis("-fullsa")) {
     shift(); sag::dofullsa(argi());
     }
+// (4') parallel tempering: -sagpt <replicas> <time in seconds>
+  else if(argis("-sagpt")) {
+    shift(); int replicas = argi();
+    if(replicas < 1) { println(hlog, "-sagpt: the number of replicas must be positive"); exit(1); }
+    shift(); sag::dopartemp(replicas, argi());
+    }
+  else if(argis("-sagptit")) {
+    shift(); sag::pt_iterations = argi();
+    }
+// (4'') save the best layout found by -sagpt every <interval> seconds
+  else if(argis("-sagcheckpoint")) {
+    shift(); sag::checkpoint_fname = args();
+    shift(); sag::checkpoint_interval = argi();
+    }
 // (5) save the positioning
   else if(argis("-gsave")) {
     PHASE(3); shift(); sag::savesnake(args());
@@ -550,7 +825,7 @@ string cname() {
 
 int ah = addHook(hooks_args, 100, readArgs)
   + addHook(shmup::hooks_turn, 100, turn)
-  + addHook(rogueviz::hooks_close, 100, [] { sag::sagedges.clear(); })
+  + addHook(rogueviz::hooks_close, 100, [] { sag::sagedges.clear(); vector<unsigned char>().swap(sag::snakematrix); vector<vector<pair<int, int>>>().swap(sag::hub_labels); })
   + addHook(rogueviz::hooks_rvmenu, 100, [] { 
     if(vizid != &sag_id) return;
     dialog::addSelItem(XLAT("temperature"), fts(sag::temperature), 't');
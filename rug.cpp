@@ -65,6 +65,7 @@ bool computed = false;
       }
     int dexp_id;
     dexp_data surface_point;
+    flagtype batch_colors; // used by the parallel solver: colors of the edges in the current batch
     };
 
   struct triangle {
@@ -164,6 +165,56 @@ bool rug_hyperbolic() { USING_NATIVE_GEOMETRY; return hyperbolic; }
 bool rug_sphere() { USING_NATIVE_GEOMETRY; return sphere; }
 bool rug_elliptic() { USING_NATIVE_GEOMETRY; return elliptic; }
 
+/* findRugpoint used to check all the points, making buildRug quadratic. Now the points are
+ * also binned by their coordinates, in bins much larger than the tolerance of findRugpoint,
+ * so only the bins containing h, or adjacent to it, need to be checked. */
+
+typedef long long bincode;
+
+const ld point_bin_size = 1e-3;
+/** the tolerance of findRugpoint (with a safety margin); in the hyperbolic case, the binned
+ *  coordinates of points within this distance of h may differ by up to h[LDIM] times more */
+const ld point_bin_margin = 2e-5;
+
+open_map<bincode, vector<rugpoint*>, integer_hash> point_bins;
+int binned_points;
+bool shifted_points;
+
+/** binning is exact when geo_dist_q bounds the differences of the binned coordinates; in the
+ *  hyperbolic case, the timelike coordinate is not binned, but it is not used in 2D */
+bool can_bin() {
+  bool flat = GDIM == 2;
+  USING_NATIVE_GEOMETRY;
+  return euclid || sphere || (hyperbolic && flat);
+  }
+
+bool bin_coordinate(int i) {
+  USING_NATIVE_GEOMETRY;
+  return i < MDIM && sig(i) > 0;
+  }
+
+bincode point_bin_code(const array<int, 4>& v) {
+  bincode res = 0;
+  for(int i=0; i<4; i++) res = (res << 16) | (bin_coordinate(i) ? v[i] & 0xFFFF : 0);
+  return res;
+  }
+
+void bin_point(rugpoint *m) {
+  if(m->h.shift) shifted_points = true;
+  array<int, 4> v;
+  for(int i=0; i<4; i++) v[i] = int(floor(m->h.h[i] / point_bin_size));
+  point_bins[point_bin_code(v)].push_back(m);
+  binned_points++;
+  }
+
+/** needed if the points have been changed other than by addRugpoint */
+void rebin_points() {
+  point_bins.clear();
+  binned_points = 0;
+  shifted_points = false;
+  for(auto m: points) bin_point(m);
+  }
+
 EX rugpoint *addRugpoint(shiftpoint h, double dist) {
   rugpoint *m = new rugpoint;
   m->h = h;
@@ -266,13 +317,51 @@ EX rugpoint *addRugpoint(shiftpoint h, double dist) {
   m->inqueue = false;
   m->dist = dist;
   points.push_back(m);
+  if(binned_points == isize(points) - 1) bin_point(m);
   return m;
   }
 
 EX rugpoint *findRugpoint(shiftpoint h) {
-  USING_NATIVE_GEOMETRY;
-  for(int i=0; i<isize(points); i++) 
-    if(geo_dist_q(points[i]->h.h, unshift(h, points[i]->h.shift)) < 1e-5) return points[i];
+  if(binned_points != isize(points)) rebin_points();
+  if(h.shift || shifted_points || !can_bin()) {
+    USING_NATIVE_GEOMETRY;
+    for(int i=0; i<isize(points); i++) 
+      if(geo_dist_q(points[i]->h.h, unshift(h, points[i]->h.shift)) < 1e-5) return points[i];
+    return NULL;
+    }
+  bool ell;
+  hyperpoint h1;
+  ld margin = point_bin_margin;
+  if(1) {
+    USING_NATIVE_GEOMETRY;
+    ell = elliptic;
+    h1 = unshift(h);
+    /* moving by d at distance r from C0 changes the spacelike coordinates by at most about d * cosh(r) */
+    if(hyperbolic) margin *= h1[LDIM];
+    }
+  margin /= point_bin_size;
+  for(int s=0; s<(ell ? 2 : 1); s++) {
+    /* check every bin within the tolerance of h1 (usually just one) */
+    array<int, 4> lo, hi;
+    for(int i=0; i<4; i++) {
+      ld x = (s ? -h1[i] : h1[i]) / point_bin_size;
+      lo[i] = hi[i] = int(floor(x));
+      if(!bin_coordinate(i)) continue;
+      lo[i] = int(floor(x - margin));
+      hi[i] = int(floor(x + margin));
+      }
+    array<int, 4> v;
+    for(v[0]=lo[0]; v[0]<=hi[0]; v[0]++)
+    for(v[1]=lo[1]; v[1]<=hi[1]; v[1]++)
+    for(v[2]=lo[2]; v[2]<=hi[2]; v[2]++)
+    for(v[3]=lo[3]; v[3]<=hi[3]; v[3]++) {
+      auto bin = point_bins.find(point_bin_code(v));
+      if(!bin) continue;
+      USING_NATIVE_GEOMETRY;
+      for(rugpoint *p: *bin)
+        if(geo_dist_q(p->h.h, unshift(h, p->h.shift)) < 1e-5) return p;
+      }
+    }
   return NULL;
   }
 
@@ -288,6 +377,8 @@ void addNewEdge(rugpoint *e1, rugpoint *e2, ld len = 1) {
   }
 
 EX bool edge_exists(rugpoint *e1, rugpoint *e2) {
+  // edges are always added in both directions, so it is enough to check the shorter list
+  if(isize(e2->edges) < isize(e1->edges)) swap(e1, e2);
   for(auto& e: e1->edges)
     if(e.target == e2)
       return true;
@@ -514,6 +605,7 @@ void comp(cell*& minimum, cell *next) {
 
 EX void buildRug() {
 
+  auto t = SDL_GetTicks();
   need_mouseh = true;
   good_shape = false;
   if(euclid && bounded) {
@@ -580,6 +672,8 @@ EX void buildRug() {
   verify();
   
   for(auto p: points) if(p->valid) qvalid++;
+
+  DEBB(DF_GEOM, ("rug built in ", int(SDL_GetTicks() - t), " ms"));
   }
 
 // rug physics
@@ -592,35 +686,32 @@ EX void enqueue(rugpoint *m) {
   m->inqueue = true;
   }
 
-bool force_euclidean(rugpoint& m1, rugpoint& m2, double rd, bool is_anticusp = false, double d1=1, double d2=1) {
-  if(!m1.valid || !m2.valid) return false;
-  USING_NATIVE_GEOMETRY;
+bool force_euclidean(rugpoint& m1, rugpoint& m2, double rd, ld& total_error, bool is_anticusp, double d1, double d2) {
   // double rd = geo_dist_q(m1.h, m2.h) * xd;
   double t = sqhypot_d(3, m1.native - m2.native);
   if(is_anticusp && t > rd*rd) return false;
   t = sqrt(t);
-  current_total_error += (t-rd) * (t-rd);
+  total_error += (t-rd) * (t-rd);
   bool nonzero = abs(t-rd) > err_zero_current;
   double force = (t - rd) / t / 2; // 20.0;
   for(int i=0; i<3; i++) {
     double di = (m2.native[i] - m1.native[i]) * force;
     m1.native[i] += di * d1;
     m2.native[i] -= di * d2;
-    if(nonzero && d2>0) enqueue(&m2);
     }  
   return nonzero;
   }
 
-bool force(rugpoint& m1, rugpoint& m2, double rd, bool is_anticusp=false, double d1=1, double d2=1) {
-  if(!m1.valid || !m2.valid) return false;
-  if(rug_euclid() && fast_euclidean) {
-    return force_euclidean(m1, m2, rd, is_anticusp, d1, d2);
-    }
-  USING_NATIVE_GEOMETRY;
+/** the computation of force(), without the bookkeeping: the native geometry must be already set,
+ *  and the squared error is added to total_error; only m1 and m2 are changed
+ */
+bool force_native(rugpoint& m1, rugpoint& m2, double rd, ld& total_error, bool is_anticusp, double d1, double d2) {
+  if(euclid && fast_euclidean)
+    return force_euclidean(m1, m2, rd, total_error, is_anticusp, d1, d2);
   
   ld t = geo_dist_q(m1.native, m2.native);
   if(is_anticusp && t > rd) return false;
-  current_total_error += (t-rd) * (t-rd);
+  total_error += (t-rd) * (t-rd);
   bool nonzero = abs(t-rd) > err_zero_current;
   double forcev = (t - rd) / 2; // 20.0;
   
@@ -629,15 +720,23 @@ bool force(rugpoint& m1, rugpoint& m2, double rd, bool is_anticusp=false, double
 
   transmatrix iT = rgpushxto0(m1.native);
   
-  for(int i=0; i<MDIM; i++) if(std::isnan(m1.native[i])) { 
+  m1.native = iT * direct_exp(ie * (d1*forcev/t));
+  m2.native = iT * direct_exp(ie * ((t-d2*forcev)/t));
+
+  return nonzero;
+  }
+
+bool force(rugpoint& m1, rugpoint& m2, double rd, bool is_anticusp=false, double d1=1, double d2=1) {
+  if(!m1.valid || !m2.valid) return false;
+  USING_NATIVE_GEOMETRY;
+  
+  if(!(euclid && fast_euclidean)) for(int i=0; i<MDIM; i++) if(std::isnan(m1.native[i])) { 
     addMessage("Failed!");
     println(hlog, "m1 = ", m1.native);
     throw rug_exception();
     }
 
-  m1.native = iT * direct_exp(ie * (d1*forcev/t));
-  m2.native = iT * direct_exp(ie * ((t-d2*forcev)/t));
-
+  bool nonzero = force_native(m1, m2, rd, current_total_error, is_anticusp, d1, d2);
   if(nonzero && d2>0) enqueue(&m2);
   return nonzero;
   }
@@ -807,8 +906,6 @@ EX ld modeldist(const hyperpoint& h1, const hyperpoint& h2) {
   USING_NATIVE_GEOMETRY;
   return geo_dist_q(h1, h2);
   }
-
-typedef long long bincode;
 const bincode sY = (1<<16);
 const bincode sZ = sY * sY;
 const bincode sT = sY * sY * sY;
@@ -925,6 +1022,117 @@ EX void addNewPoints() {
   if(qvalid != oqvalid) { println(hlog, "adding new points ", make_tuple(oqvalid, qvalid, isize(points), dist, dt, queueiter)); }
   }
 
+/** number of threads used by the parallel solver; 0 to use the sequential queue instead */
+EX int physics_threads = 0;
+
+/** The parallel solver takes all the queued points at once, and applies force() to all their
+ *  edges. The edges are colored so that the edges of the same color have no common endpoints,
+ *  and thus can be processed at the same time. The queue is kept as in the sequential solver,
+ *  so both solvers can be used interchangeably.
+ */
+struct batch_edge {
+  rugpoint *m1, *m2;
+  ld len;
+  bool is_anticusp;
+  };
+
+vector<batch_edge> batch, batch_sorted;
+vector<int> batch_start;
+
+/** edges which did not get one of the 64 colors, processed sequentially after the others */
+static const int leftover_color = 64;
+
+bool can_relax_in_parallel() {
+  USING_NATIVE_GEOMETRY;
+  return physics_threads > 0 && !nonisotropic && !prod;
+  }
+
+struct relax_result {
+  ld total_error;
+  vector<rugpoint*> to_enqueue;
+  bool failed;
+  relax_result() { total_error = 0; failed = false; }
+  };
+
+void relax_range(int from, int to, relax_result& res) {
+  for(int i=from; i<to; i++) {
+    auto& e = batch_sorted[i];
+    if(force_native(*e.m1, *e.m2, e.len, res.total_error, e.is_anticusp, 1, 1)) {
+      res.to_enqueue.push_back(e.m1);
+      res.to_enqueue.push_back(e.m2);
+      }
+    for(int j=0; j<MDIM; j++) if(std::isnan(e.m1->native[j])) res.failed = true;
+    }
+  }
+
+/** relax all the queued points */
+void parallel_sweep() {
+  vector<rugpoint*> active;
+  while(!pqueue.empty()) {
+    active.push_back(pqueue.front());
+    pqueue.pop();
+    }
+
+  /* edges between two queued points are taken once, from the greater one */
+  batch.clear();
+  for(auto m: active) if(m->valid) {
+    for(auto& e: m->edges)
+      if(e.target->valid && !(e.target->inqueue && e.target > m))
+        batch.push_back(batch_edge{m, e.target, e.len, false});
+    for(auto& e: m->anticusp_edges)
+      if(e.target->valid && !(e.target->inqueue && e.target > m))
+        batch.push_back(batch_edge{m, e.target, anticusp_dist, true});
+    }
+  for(auto m: active) m->inqueue = false;
+
+  for(auto& e: batch) e.m1->batch_colors = e.m2->batch_colors = 0;
+  batch_start.assign(leftover_color+2, 0);
+  vector<int> colors(isize(batch));
+  for(int i=0; i<isize(batch); i++) {
+    auto& e = batch[i];
+    flagtype free = ~(e.m1->batch_colors | e.m2->batch_colors);
+    int c = 0;
+    if(!free) c = leftover_color;
+    else {
+      while(!(free & (1ull << c))) c++;
+      e.m1->batch_colors |= (1ull << c);
+      e.m2->batch_colors |= (1ull << c);
+      }
+    colors[i] = c;
+    batch_start[c+1]++;
+    }
+  for(int c=0; c<=leftover_color; c++) batch_start[c+1] += batch_start[c];
+  batch_sorted.resize(isize(batch));
+  vector<int> pos = batch_start;
+  for(int i=0; i<isize(batch); i++) batch_sorted[pos[colors[i]]++] = batch[i];
+
+  USING_NATIVE_GEOMETRY;
+  int threads = physics_threads;
+  #if !CAP_THREAD
+  threads = 1;
+  #endif
+  vector<relax_result> results(threads);
+  for(int c=0; c<=leftover_color; c++) {
+    int a = batch_start[c], b = batch_start[c+1];
+    if(threads > 1 && c < leftover_color && b - a >= 16 * threads) {
+      parallel_chunks(threads, [&] (int k) { relax_range(a + (b-a)*k/threads, a + (b-a)*(k+1)/threads, results[k]); });
+      continue;
+      }
+    relax_range(a, b, results[0]);
+    }
+
+  for(auto& r: results) {
+    if(r.failed) {
+      addMessage("Failed!");
+      throw rug_exception();
+      }
+    current_total_error += r.total_error;
+    for(auto m: r.to_enqueue) enqueue(m);
+    }
+  queueiter += isize(active);
+  if(!pqueue.empty()) need_mouseh = true;
+  }
+
 EX void physics() {
 
   #if CAP_CRYSTAL
@@ -940,6 +1148,13 @@ EX void physics() {
   
   current_total_error = 0;
   
+  if(can_relax_in_parallel()) {
+    while(SDL_GetTicks() < t + 5 && !stop)
+      if(pqueue.empty()) addNewPoints();
+      else parallel_sweep();
+    return;
+    }
+
   while(SDL_GetTicks() < t + 5 && !stop)
   for(int it=0; it<50 && !stop; it++)
     if(pqueue.empty()) addNewPoints();
@@ -1201,7 +1416,12 @@ EX void clear_model() {
   triangles.clear();
   for(int i=0; i<isize(points); i++) delete points[i];
   points.clear();
+  point_bins.clear();
+  binned_points = 0;
+  shifted_points = false;
   pqueue = queue<rugpoint*> ();
+  batch.clear();
+  batch_sorted.clear();
   }
   
 EX void close() {
@@ -1496,6 +1716,7 @@ EX void show() {
     }
   dialog::addSelItem(XLAT("automatic move speed"), fts(ruggo), 'G');
   dialog::addSelItem(XLAT("anti-crossing"), fts(anticusp_factor), 'A');
+  dialog::addSelItem(XLAT("solver threads"), physics_threads ? its(physics_threads) : XLAT("sequential"), 't');
   dialog::addBoolItem(XLAT("3D monsters/walls on the surface"), spatial_rug, 'S');
   dialog::add_action([] () { spatial_rug = !spatial_rug; });
   edit_levellines('L');
@@ -1548,6 +1769,13 @@ EX void show() {
           "The bigger number, the more sensitive it is, but the embedding is slower. Set 0 to disable.")
         );
       }
+    else if(uni == 't') {
+      dialog::editNumber(physics_threads, 0, 64, 1, 0, XLAT("solver threads"), 
+        XLAT("If non-zero, the edges of the model are relaxed in parallel batches, using this many threads. "
+        "If zero, the points are relaxed one by one, which uses a single core. "
+        "Nil, Solv and product geometries always use the sequential method.")
+        );
+      }
     else if(uni == 'v') {
       dialog::editNumber(vertex_limit, 0, 50000, 500, 3000, ("vertex limit"), 
         XLAT("The more vertices, the more accurate the Hypersian Rug model is. "
@@ -1802,6 +2030,10 @@ int rugArgs() {
     change_texturesize();
     }
 
+  else if(argis("-rugthreads")) {
+    shift(); physics_threads = argi();
+    }
+
   else if(argis("-rugv")) {
     shift(); vertex_limit = argi();
     err_zero_current = err_zero;
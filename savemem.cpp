@@ -46,7 +46,7 @@ void slow_delete_cell(cell *c) {
     if(c->move(i))
       c->move(i)->move(c->c.spin(i)) = NULL;
   removed_cells.push_back(c);
-  delete c;
+  destroy_cell(c);
   }
 
 void delete_heptagon(heptagon *h2) {
@@ -60,7 +60,7 @@ void delete_heptagon(heptagon *h2) {
   for(int i=0; i<S7; i++)
     if(h2->move(i))
       h2->move(i)->move(h2->c.spin(i)) = NULL;
-  delete h2;
+  tailored_delete(h2);
   }
 
 void recursive_delete(heptagon *h, int i) {
@@ -164,7 +164,7 @@ EX void save_memory() {
     }
   
   last_cleared = at1;
-  DEBB(DF_MEMORY, ("current cellcount = ", cellcount));
+  DEBB(DF_MEMORY, ("current cellcount = ", cellcount, " arena: ", arena_info(arena_of<cell>())));
   
   sort(removed_cells.begin(), removed_cells.end());
   callhooks(hooks_removecells);
@@ -173,6 +173,11 @@ EX void save_memory() {
 
 EX purehookset hooks_removecells;
 
+/** \brief a short description of the state of a tailored_arena, for memory statistics */
+EX string arena_info(const tailored_arena& a) {
+  return its(a.live) + " live, " + its(a.freed) + " free, " + its(int(a.reserved_bytes() >> 20)) + " MB in " + its(isize(a.blocks)) + " blocks";
+  }
+
 EX bool is_cell_removed(cell *c) {
   return binary_search(removed_cells.begin(), removed_cells.end(), c);
   }
@@ -253,7 +258,11 @@ EX void show_memory_menu() {
     "again and can be safely forgotten.\n\n")
     );
   
-  if(cheater) dialog::addSelItem(XLAT("cells in memory"), its(cellcount) + "+" + its(heptacount), 0);
+  if(cheater) {
+    dialog::addSelItem(XLAT("cells in memory"), its(cellcount) + "+" + its(heptacount), 0);
+    dialog::addSelItem(XLAT("cell arena"), arena_info(arena_of<cell>()), 0);
+    dialog::addSelItem(XLAT("heptagon arena"), arena_info(arena_of<heptagon>()), 0);
+    }
   
   dialog::addBoolItem(XLAT("memory saving mode"), memory_saving_mode, 'f');
   dialog::add_action([] { memory_saving_mode = !memory_saving_mode; if(memory_saving_mode) save_memory(), apply_memory_reserve(); });
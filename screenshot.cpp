@@ -674,18 +674,149 @@ EX SDL_Surface *empty_surface(int x, int y, bool alpha) {
   }
 #endif
 
+/** the number of frame buffers used by the capture writer thread while recording animations (0: write the frames synchronously) */
+EX int async_buffers = 0;
+
+/** set while recording an animation, so that output() may return before the frame is written */
+EX bool in_batch = false;
+
+/** capture statistics, in ms: rendering, postprocessing, waiting for a free buffer, copying to the buffer, and writing (in the writer thread) */
+int capture_frames, time_render, time_convert, time_wait, time_copy, time_write;
+
+int frame_start;
+
 #if CAP_PNG
 
-void output(SDL_Surface* s, const string& fname) {
-  if(format == screenshot_format::rawfile) {
-    for(int y=0; y<shoty; y++)
-      ignore(write(rawfile_handle, &qpixel(s, 0, y), 4 * shotx));
+void write_frame(SDL_Surface *s, int x, int y, screenshot_format fmt, int handle, const string& fname) {
+  if(fmt == screenshot_format::rawfile) {
+    for(int iy=0; iy<y; iy++)
+      ignore(write(handle, &qpixel(s, 0, iy), 4 * x));
     }
   else
     IMAGESAVE(s, fname.c_str());
   }
 
+#if CAP_THREAD
+/** a frame waiting for the capture writer */
+struct captured_frame {
+  SDL_Surface *s;
+  screenshot_format fmt;
+  int handle;
+  string fname;
+  };
+
+/** the slots are allocated when the writer starts, and not resized until it stops */
+vector<captured_frame> capture_slots;
+vector<int> free_capture_slots;
+std::queue<int> queued_captures;
+std::mutex capture_lock;
+std::condition_variable capture_cv;
+std::thread capture_writer;
+bool capture_writer_stop;
+
+void capture_writer_loop() {
+  while(true) {
+    int id;
+    {
+      std::unique_lock<std::mutex> lk(capture_lock);
+      capture_cv.wait(lk, [] { return capture_writer_stop || !queued_captures.empty(); });
+      if(queued_captures.empty()) return;
+      id = queued_captures.front();
+      queued_captures.pop();
+      }
+    auto& f = capture_slots[id];
+    int t = SDL_GetTicks();
+    write_frame(f.s, f.s->w, f.s->h, f.fmt, f.handle, f.fname);
+    {
+      std::unique_lock<std::mutex> lk(capture_lock);
+      time_write += SDL_GetTicks() - t;
+      free_capture_slots.push_back(id);
+      }
+    capture_cv.notify_all();
+    }
+  }
+
+/** copy s into a free buffer (waiting for one if all are in use) and let the writer thread save it */
+void output_async(SDL_Surface *s, const string& fname) {
+  if(!capture_writer.joinable()) {
+    capture_slots.assign(async_buffers, captured_frame{nullptr, format, -1, ""});
+    free_capture_slots.clear();
+    for(int i=0; i<async_buffers; i++) free_capture_slots.push_back(i);
+    capture_writer_stop = false;
+    capture_writer = std::thread(capture_writer_loop);
+    }
+
+  int t0 = SDL_GetTicks();
+  int id;
+  {
+    std::unique_lock<std::mutex> lk(capture_lock);
+    capture_cv.wait(lk, [] { return !free_capture_slots.empty(); });
+    id = free_capture_slots.back();
+    free_capture_slots.pop_back();
+    }
+  int t1 = SDL_GetTicks();
+  time_wait += t1 - t0;
+
+  auto& f = capture_slots[id];
+  bool alpha = s->format->Amask;
+  if(!f.s || f.s->w != shotx || f.s->h != shoty || bool(f.s->format->Amask) != alpha) {
+    if(f.s) SDL_FreeSurface(f.s);
+    f.s = empty_surface(shotx, shoty, alpha);
+    }
+  for(int y=0; y<shoty; y++)
+    memcpy(&qpixel(f.s, 0, y), &qpixel(s, 0, y), 4 * shotx);
+  f.fmt = format;
+  f.handle = rawfile_handle;
+  f.fname = fname;
+  time_copy += SDL_GetTicks() - t1;
+
+  {
+    std::unique_lock<std::mutex> lk(capture_lock);
+    queued_captures.push(id);
+    }
+  capture_cv.notify_all();
+  }
+#endif
+
+void output(SDL_Surface* s, const string& fname) {
+  capture_frames++;
+  #if CAP_THREAD
+  if(in_batch && async_buffers > 0) {
+    output_async(s, fname);
+    return;
+    }
+  #endif
+  int t = SDL_GetTicks();
+  write_frame(s, shotx, shoty, format, rawfile_handle, fname);
+  time_write += SDL_GetTicks() - t;
+  }
+#endif
+
+/** wait until all the captured frames are written, and report the capture statistics */
+EX void flush_output() {
+  #if CAP_PNG && CAP_THREAD
+  if(capture_writer.joinable()) {
+    {
+      std::unique_lock<std::mutex> lk(capture_lock);
+      capture_writer_stop = true;
+      }
+    capture_cv.notify_all();
+    capture_writer.join();
+    for(auto& f: capture_slots) if(f.s) SDL_FreeSurface(f.s);
+    capture_slots.clear();
+    free_capture_slots.clear();
+    }
+  #endif
+  if(capture_frames > 1)
+    println(hlog, "captured ", capture_frames, " frames: render ", time_render, " ms, convert ", time_convert, " ms, wait ", time_wait, " ms, copy ", time_copy, " ms, write ", time_write, " ms");
+  capture_frames = time_render = time_convert = time_wait = time_copy = time_write = 0;
+  }
+
+#if CAP_PNG
+
 EX void postprocess(string fname, SDL_Surface *sdark, SDL_Surface *sbright) {
+  int t = SDL_GetTicks();
+  time_render += t - frame_start;
   if(gamma == 1 && shot_aa == 1 && sdark == sbright) {
     output(sdark, fname);
     return;
@@ -717,6 +848,7 @@ EX void postprocess(string fname, SDL_Surface *sdark, SDL_Surface *sbright) {
       part(pix, p) = v;
       }
     }
+  time_convert += SDL_GetTicks() - t;
   output(sout, fname);
   SDL_FreeSurface(sout);
   }
@@ -761,6 +893,7 @@ void render_png(string fname, const function<void()>& what) {
 EX void take(string fname, const function<void()>& what IS(default_screenshot_content)) {
 
   if(cheater) doOvergenerate();
+  frame_start = SDL_GetTicks();
   
   #if CAP_SVG  
   int multiplier = (format == screenshot_format::svg) ? svg::divby : shot_aa;
@@ -826,6 +959,9 @@ int png_read_args() {
   else if(argis("-shothud")) {
     shift(); hide_hud = !argi();
     }
+  else if(argis("-shotasync")) {
+    shift(); async_buffers = argi();
+    }
   else if(argis("-shott")) {
     shift(); shot::transparent = argi();
     }
@@ -1323,13 +1459,22 @@ int min_frame = 0, max_frame = 999999;
 
 int numturns = 0;
 
+/** the number of processes rendering the frames in parallel (0 or 1: render in this process) */
+EX int animation_workers = 0;
+
+/** in a worker process, only every frame_stride-th frame is rendered, starting from frame_offset */
+int frame_stride = 1, frame_offset = 0;
+
 EX bool record_animation() {
+  dynamicval<bool> db(shot::in_batch, true);
   lastticks = 0;
   ticks = 0;
   int oldturn = -1;
   for(int i=0; i<noframes; i++) {
     if(i < min_frame || i > max_frame) continue;
-    printf("%d/%d\n", i, noframes);
+    /* the other frames still need to be replayed, so that the animation state is the same */
+    bool render = (i - max(min_frame, 0)) % frame_stride == frame_offset;
+    if(render) printf("%d/%d\n", i, noframes);
     int newticks = i * period / noframes;
     cmode = (env_shmup ? sm::NORMAL : 0);
     while(ticks < newticks) shmup::turn(1), ticks++;
@@ -1350,29 +1495,90 @@ EX bool record_animation() {
       history::movetophase();
       }
     
-    char buf[1000];
-    snprintf(buf, 1000, animfile.c_str(), i);
-    shot::take(buf);
+    if(render) {
+      char buf[1000];
+      snprintf(buf, 1000, animfile.c_str(), i);
+      shot::take(buf);
+      }
     rollback();
     }
+  shot::flush_output();
   lastticks = ticks = SDL_GetTicks();
   return true;
   }
+
+#if CAP_VIDEO
+/** fork, with no threads of ours running anything: the capture writer is stopped, and the thread pool is idle */
+int fork_quietly() {
+  shot::flush_output();
+  pool_before_fork();
+  int pid = fork();
+  pool_after_fork(pid == 0);
+  return pid;
+  }
+
+/** fork a process which runs record_animation for every workers-th frame, starting from frame k;
+ *  the software renderer is used, since the GL context cannot be shared; the animation state
+ *  advances from frame to frame, so the worker still replays the frames it does not render */
+int fork_animation_worker(int workers, int k, const function<void()>& prepare) {
+  int pid = fork_quietly();
+  if(pid == 0) {
+    prepare();
+    vid.usingGL = false;
+    frame_stride = workers; frame_offset = k;
+    bool ok = record_animation();
+    fflush(stdout);
+    _exit(ok ? 0 : 1);
+    }
+  return pid;
+  }
+
+/** wait for the given animation workers; returns false (with a message) if any of them has failed */
+bool wait_for_workers(const vector<int>& pids) {
+  bool ok = true;
+  for(int pid: pids) {
+    int status;
+    while(waitpid(pid, &status, 0) < 0) if(errno != EINTR) { status = -1; break; }
+    if(status == -1 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+      if(status != -1 && WIFSIGNALED(status)) addMessage(format("Error: animation worker %d killed by signal %d", pid, WTERMSIG(status)));
+      else addMessage(format("Error: animation worker %d failed", pid));
+      ok = false;
+      }
+    }
+  return ok;
+  }
+
+/** record_animation, with the frames rendered by animation_workers processes */
+EX bool record_animation_parallel() {
+  if(animation_workers <= 1) return record_animation();
+  vector<int> pids;
+  bool ok = true;
+  for(int k=0; k<animation_workers; k++) {
+    int pid = fork_animation_worker(animation_workers, k, [] {});
+    /* the frames of this worker will be missing */
+    if(pid < 0) { addMessage(format("Error: %s", strerror(errno))); ok = false; }
+    else pids.push_back(pid);
+    }
+  if(!wait_for_workers(pids)) ok = false;
+  lastticks = ticks = SDL_GetTicks();
+  return ok;
+  }
+#endif
 #endif
 
 EX purehookset hooks_after_video;
 
 #if CAP_VIDEO
-EX bool record_video(string fname IS(videofile), bool_reaction_t rec IS(record_animation)) {
-  
+/** start ffmpeg encoding raw frames into fname; returns the pipe to write the frames to, or -1 */
+int start_encoder(const string& fname) {
   array<int, 2> tab;
   if(pipe(&tab[0])) {
     addMessage(format("Error: %s", strerror(errno)));
-    return false;
+    return -1;
     }
   println(hlog, "tab = ", tab);
   
-  int pid = fork();
+  int pid = fork_quietly();
   if(pid == 0) {
     close(0);
     if(dup(tab[0]) != 0) exit(1);
@@ -1384,16 +1590,126 @@ EX bool record_video(string fname IS(videofile), bool_reaction_t rec IS(record_a
     }
   
   close(tab[0]);
-  shot::rawfile_handle = tab[1];
+  return tab[1];
+  }
+
+EX bool record_video(string fname IS(videofile), bool_reaction_t rec IS(record_animation)) {
+  int fd = start_encoder(fname);
+  if(fd < 0) return false;
+  shot::rawfile_handle = fd;
   dynamicval<shot::screenshot_format> sf(shot::format, shot::screenshot_format::rawfile);
   rec();
-  close(tab[1]);
+  shot::flush_output();
+  close(fd);
   wait(nullptr);
   callhooks(hooks_after_video);
   return true;
   }
 
+/** how many rendered frames of each worker may wait for their turn in record_video_parallel */
+EX int video_reorder_buffer = 4;
+
+bool write_fully(int fd, const char *data, int size) {
+  while(size > 0) {
+    int r = write(fd, data, size);
+    if(r <= 0) return false;
+    data += r; size -= r;
+    }
+  return true;
+  }
+
+/** like record_video with record_animation, but the frames are rendered by animation_workers processes;
+ *  worker k renders frames k, k+workers, ..., and the frames are put back in order before encoding */
+EX bool record_video_parallel(string fname IS(videofile)) {
+  int workers = animation_workers;
+  int fd = start_encoder(fname);
+  if(fd < 0) return false;
+
+  int frame_size = 4 * shot::shotx * shot::shoty;
+  vector<int> pids, sources;
+  for(int k=0; k<workers; k++) {
+    array<int, 2> tab;
+    if(pipe(&tab[0])) {
+      addMessage(format("Error: %s", strerror(errno)));
+      break;
+      }
+    int pid = fork_animation_worker(workers, k, [&] {
+      close(fd); close(tab[0]);
+      for(int s: sources) close(s);
+      shot::rawfile_handle = tab[1];
+      shot::format = shot::screenshot_format::rawfile;
+      });
+    close(tab[1]);
+    if(pid < 0) {
+      addMessage(format("Error: %s", strerror(errno)));
+      close(tab[0]);
+      break;
+      }
+    pids.push_back(pid); sources.push_back(tab[0]);
+    }
+  /* frame i comes from worker i % workers, so we cannot go on without any of them */
+  bool ok = isize(sources) == workers;
+
+  int frames = min(noframes-1, max_frame) - max(min_frame, 0) + 1;
+  vector<queue<vector<char>>> ready(workers);
+  vector<vector<char>> partial(workers, vector<char>(frame_size));
+  vector<int> filled(workers, 0);
+  vector<bool> finished(workers, false);
+
+  int next = 0;
+  if(ok) while(next<frames) {
+    int k = next % workers;
+    if(!ready[k].empty()) {
+      if(!write_fully(fd, &ready[k].front()[0], frame_size)) {
+        addMessage(format("Error: %s", strerror(errno)));
+        break;
+        }
+      ready[k].pop();
+      next++;
+      continue;
+      }
+    if(finished[k]) break;
+
+    /* workers whose buffers are full are not read, so they wait until their frames are needed */
+    vector<pollfd> pfd;
+    vector<int> who;
+    for(int j=0; j<workers; j++) if(!finished[j] && isize(ready[j]) < video_reorder_buffer) {
+      pfd.push_back(pollfd{sources[j], POLLIN, 0});
+      who.push_back(j);
+      }
+    if(poll(&pfd[0], isize(pfd), -1) < 0) {
+      if(errno == EINTR) continue;
+      break;
+      }
+    for(int i=0; i<isize(pfd); i++) if(pfd[i].revents) {
+      int j = who[i];
+      int r = read(sources[j], &partial[j][filled[j]], frame_size - filled[j]);
+      if(r <= 0) { finished[j] = true; continue; }
+      filled[j] += r;
+      if(filled[j] == frame_size) {
+        ready[j].push(std::move(partial[j]));
+        partial[j].resize(frame_size);
+        filled[j] = 0;
+        }
+      }
+    }
+
+  if(ok && next < frames) {
+    addMessage(format("Error: only %d of %d frames written", next, frames));
+    ok = false;
+    }
+
+  for(int s: sources) close(s);
+  if(!wait_for_workers(pids)) ok = false;
+  close(fd);
+  wait(nullptr);
+  lastticks = ticks = SDL_GetTicks();
+  callhooks(hooks_after_video);
+  return ok;
+  }
+
 EX bool record_video_std() {
+  if(animation_workers > 1) return record_video_parallel(videofile);
   return record_video(videofile, record_animation);
   }
 #endif
@@ -1684,7 +2000,15 @@ int readArgs() {
     }
   else if(argis("-animrecord") || argis("-animrec")) {
     PHASE(3); shift(); noframes = argi();
-    shift(); animfile = args(); record_animation();
+    shift(); animfile = args();
+    #if CAP_VIDEO
+    record_animation_parallel();
+    #else
+    record_animation();
+    #endif
+    }
+  else if(argis("-animworkers")) {
+    PHASEFROM(2); shift(); animation_workers = argi();
     }
   else if(argis("-record-only")) {
     PHASEFROM(2); 
@@ -1695,7 +2019,7 @@ int readArgs() {
 #if CAP_VIDEO
   else if(argis("-animvideo")) {
     PHASE(3); shift(); noframes = argi();
-    shift(); videofile = args(); record_video();
+    shift(); videofile = args(); record_video_std();
     }
 #endif
   else if(argis("-animcircle")) {
@@ -73,10 +73,11 @@ struct monster {
   double footphase;
   bool isVirtual;  // off the screen: gmatrix is unknown, and pat equals at
   hyperpoint inertia;// for frictionless lands
+  int nvid;        // index in nonvirtual during turn(), or -1
   
   monster() { 
     dead = false; inBoat = false; parent = NULL; nextshot = 0; 
-    stunoff = 0; blowoff = 0; footphase = 0; no_targetting = false;
+    stunoff = 0; blowoff = 0; footphase = 0; no_targetting = false; nvid = -1;
     swordangle = 0; inertia = Hypc; if(prod) ori = Id;
     }
   
@@ -104,14 +105,194 @@ EX eLand delayed_safety_land;
 
 bool lastdead = false;
 
-EX multimap<cell*, monster*> monstersAt;
-
 #if HDR
-typedef multimap<cell*, monster*>::iterator mit;
+/** inactive monsters, by their base cell. This used to be a multimap<cell*, monster*>, and it
+ *  still iterates in the same order; but the entries are kept in a flat vector, grouped by cell,
+ *  and an open addressing table gives the span of each cell. New entries are only merged in
+ *  bulk, on the first query after them (usually once per turn()).
+ */
+struct monster_storage {
+  typedef pair<cell*, monster*> entry;
+  typedef vector<entry>::iterator iterator;
+  struct span { cell *c; int first, last; };
+  /** sorted by cell; erased entries have NULL monsters until the next rebuild */
+  vector<entry> data;
+  /** entries inserted since the last rebuild */
+  vector<entry> pending;
+  /** linear probing; empty slots have first == -1; the size is 1<<bits */
+  vector<span> table;
+  int bits;
+  bool garbage;
+
+  monster_storage() { garbage = false; }
+  void insert(const entry& e) { pending.push_back(e); }
+  int slot(cell *c) { return int((reinterpret_cast<size_t>(c) * 0x9E3779B97F4A7C15ull) >> (64 - bits)); }
+  span *find(cell *c);
+  pair<iterator, iterator> equal_range(cell *c);
+  /** remove all the monsters at c */
+  void erase(cell *c);
+  iterator begin() { if(garbage || !pending.empty()) rebuild(); return data.begin(); }
+  iterator end() { if(garbage || !pending.empty()) rebuild(); return data.end(); }
+  void clear() { data.clear(); pending.clear(); table.clear(); garbage = false; }
+  /** merge the pending entries; resort should be set if the cells in data have been changed */
+  void rebuild(bool resort = false);
+  };
+
+typedef monster_storage::iterator mit;
 #endif
 
+EX monster_storage monstersAt;
+
+bool by_cell(const monster_storage::entry& a, const monster_storage::entry& b) {
+  return std::less<cell*>()(a.first, b.first);
+  }
+
+void monster_storage::rebuild(bool resort) {
+  if(garbage) {
+    data.erase(remove_if(data.begin(), data.end(), [] (const entry& e) { return !e.second; }), data.end());
+    garbage = false;
+    }
+  if(resort) stable_sort(data.begin(), data.end(), by_cell);
+  if(!pending.empty()) {
+    stable_sort(pending.begin(), pending.end(), by_cell);
+    vector<entry> merged;
+    merged.reserve(data.size() + pending.size());
+    merge(data.begin(), data.end(), pending.begin(), pending.end(), back_inserter(merged), by_cell);
+    swap(data, merged);
+    pending.clear();
+    }
+  int groups = 0;
+  for(int i=0; i<isize(data); i++) if(!i || data[i].first != data[i-1].first) groups++;
+  bits = 4;
+  while((1<<bits) < 2 * groups) bits++;
+  int mask = (1<<bits) - 1;
+  table.assign(mask+1, span{nullptr, -1, -1});
+  for(int i=0; i<isize(data); i++) {
+    if(i && data[i].first == data[i-1].first) continue;
+    int j = i;
+    while(j < isize(data) && data[j].first == data[i].first) j++;
+    int k = slot(data[i].first);
+    while(table[k].first != -1) k = (k+1) & mask;
+    table[k] = span{data[i].first, i, j};
+    }
+  }
+
+monster_storage::span *monster_storage::find(cell *c) {
+  if(table.empty()) return nullptr;
+  int mask = isize(table) - 1;
+  for(int k = slot(c);; k = (k+1) & mask) {
+    span& s = table[k];
+    if(s.first == -1) return nullptr;
+    if(s.c == c) return &s;
+    }
+  }
+
+pair<mit, mit> monster_storage::equal_range(cell *c) {
+  if(!pending.empty()) rebuild();
+  span *s = find(c);
+  if(!s) return make_pair(data.end(), data.end());
+  return make_pair(data.begin() + s->first, data.begin() + s->last);
+  }
+
+void monster_storage::erase(cell *c) {
+  if(!pending.empty()) rebuild();
+  span *s = find(c);
+  if(!s || s->first == s->last) return;
+  for(int i=s->first; i<s->last; i++) data[i].second = nullptr;
+  s->last = s->first;
+  garbage = true;
+  }
+
 vector<monster*> active, nonvirtual, additional;
 
+ld collision_distance(monster *bullet, monster *target);
+
+/** the largest hdist at which sqdist is still below d (in the geometries where monster_index is used) */
+ld sqdist_range(ld d) {
+  return euclid ? sqrt(d) : 2 * asinh(sqrt(d) / 2);
+  }
+
+/** broadphase for the collision tests between nonvirtual monsters: a hash grid over the
+ *  first WDIM coordinates of their positions, built in every turn(). find() returns the monsters
+ *  which could possibly be in range; the callers still check the exact distance themselves.
+ */
+struct monster_index {
+  bool on;
+  /** size of the grid squares */
+  ld grid;
+  /** the bucket under which each monster (by nvid) is filed */
+  vector<long long> key;
+  open_map<long long, vector<monster*>, integer_hash> at;
+  /** no indexed monster has a larger collision_distance */
+  ld target_size;
+
+  long long key_of(const array<int, 3>& v) { return ((v[0] & 0x1FFFFFll) << 42) | ((v[1] & 0x1FFFFFll) << 21) | (v[2] & 0x1FFFFFll); }
+  array<int, 3> grid_of(const hyperpoint& h, ld shift = 0);
+  void build();
+  void clear() { on = false; key.clear(); at.clear(); }
+  void moved(monster *m);
+  const vector<monster*>& find(const shiftpoint& h, ld range, vector<monster*>& found);
+  };
+
+monster_index near_index;
+
+array<int, 3> monster_index::grid_of(const hyperpoint& h, ld shift) {
+  array<int, 3> res;
+  for(int i=0; i<3; i++) res[i] = i < WDIM ? int(floor((h[i] + shift) / grid)) : 0;
+  return res;
+  }
+
+void monster_index::build() {
+  clear();
+  /* with few monsters, checking all of them is faster; also, monsters must not move other than by rebasePat */
+  on = isize(nonvirtual) >= 32 && (hyperbolic || euclid) && !prod && !doall && !quotient && !fake::split();
+  for(monster *m: active) m->nvid = -1;
+  for(int i=0; i<isize(nonvirtual); i++) nonvirtual[i]->nvid = i;
+  if(!on) return;
+  grid = SCALE * 0.5;
+  target_size = 0;
+  for(monster *m: nonvirtual) {
+    key.push_back(key_of(grid_of(unshift(m->pat*C0))));
+    at[key.back()].push_back(m);
+    target_size = max(target_size, collision_distance(m, m));
+    }
+  }
+
+/** called by rebasePat to keep the index up to date */
+void monster_index::moved(monster *m) {
+  if(!on || m->nvid < 0) return;
+  long long& k = key[m->nvid];
+  long long k1 = key_of(grid_of(unshift(m->pat*C0)));
+  if(k == k1) return;
+  auto& v = at[k];
+  v.erase(std::find(v.begin(), v.end(), m));
+  k = k1;
+  at[k].push_back(m);
+  }
+
+/** all the nonvirtual monsters which could be within the given hdist of h, in the order of nonvirtual;
+ *  the result is either nonvirtual or found, so that several queries can be in progress at once;
+ *  the callers keep a static buffer for found, to avoid allocating one in every query */
+const vector<monster*>& monster_index::find(const shiftpoint& h, ld range, vector<monster*>& found) {
+  if(!on) return nonvirtual;
+  hyperpoint h1 = unshift(h);
+  /* in the hyperboloid model, moving by a unit of distance at distance d from C0 changes the first
+   * coordinates by at most cosh(d), and cosh(d) <= h1[LDIM] * exp(range) on the way to any point in range */
+  ld r = euclid ? range : range * h1[LDIM] * exp(range);
+  if(pow(2 * r / grid + 2, WDIM) > isize(nonvirtual)) return nonvirtual;
+  auto lo = grid_of(h1, -r), hi = grid_of(h1, r);
+  found.clear();
+  array<int, 3> v;
+  for(v[0]=lo[0]; v[0]<=hi[0]; v[0]++)
+  for(v[1]=lo[1]; v[1]<=hi[1]; v[1]++)
+  for(v[2]=lo[2]; v[2]<=hi[2]; v[2]++) {
+    auto p = at.find(key_of(v));
+    if(p) for(monster *m: *p) found.push_back(m);
+    }
+  sort(found.begin(), found.end(), [] (monster *m1, monster *m2) { return m1->nvid < m2->nvid; });
+  return found;
+  }
+
 cell *findbaseAround(shiftpoint p, cell *around, int maxsteps) {
 
   if(fake::split()) {
@@ -212,6 +393,7 @@ void monster::rebasePat(const shiftmatrix& new_pat, cell *c2) {
   at = inverse_shift(gmatrix[c2], pat);
   fix_to_2(at);
   fixelliptic(at);
+  near_index.moved(this);
   }
 
 bool trackroute(monster *m, shiftmatrix goal, double spd) {
@@ -1042,7 +1224,8 @@ void movePlayer(monster *m, int delta) {
     
     if(!m->isVirtual) {
       crashintomon = playerCrash(m, nat*C0);
-      for(monster *m2: nonvirtual) if(m2!=m && m2->type == passive_switch) {
+      static vector<monster*> nearby;
+      for(monster *m2: near_index.find(nat*C0, sqdist_range(SCALE2 * 0.2), nearby)) if(m2!=m && m2->type == passive_switch) {
         double d = sqdist(m2->pat*C0, nat*C0);
         if(d < SCALE2 * 0.2) crashintomon = m2;
         }
@@ -1247,7 +1430,8 @@ void movePlayer(monster *m, int delta) {
   if(items[itOrbHorns] && !m->isVirtual) {
     shiftpoint H = hornpos(cpid);
 
-    for(monster *m2: nonvirtual) {
+    static vector<monster*> nearby;
+    for(monster *m2: near_index.find(H, sqdist_range(SCALE2 * 0.1), nearby)) {
       if(m2 == m) continue;
       
       double d = sqdist(m2->pat*C0, H);
@@ -1266,7 +1450,8 @@ void movePlayer(monster *m, int delta) {
     for(double d=0; d<=1.001; d += .1) {
       shiftpoint H = swordpos(cpid, b, d);
   
-      for(monster *m2: nonvirtual) {
+      static vector<monster*> nearby;
+      for(monster *m2: near_index.find(H, sqdist_range(SCALE2 * 0.1), nearby)) {
         if(m2 == m) continue;
         
         double d = sqdist(m2->pat*C0, H);
@@ -1466,6 +1651,7 @@ EX void teleported() {
   m->base = cwt.at;
   m->at = rgpushxto0(inverse_shift(gmatrix[cwt.at], mouseh)) * spin(rand() % 1000 * M_PI / 2000);
   m->findpat();
+  near_index.moved(m);
   destroyMimics();
   }
 
@@ -1688,7 +1874,8 @@ void moveBullet(monster *m, int delta) {
 
   // items[itOrbWinter] = 100; items[itOrbLife] = 100;
   
-  if(!m->isVirtual) for(monster* m2: nonvirtual) {
+  static vector<monster*> nearby;
+  if(!m->isVirtual) for(monster* m2: near_index.find(m->pat*C0, near_index.target_size, nearby)) {
     if(m2 == m || (m2 == m->parent && m->vel >= 0) || m2->parent == m->parent) 
       continue;
     
@@ -1955,7 +2142,8 @@ void moveMonster(monster *m, int delta) {
   else {
   
     if(m->type == moSleepBull && !m->isVirtual) {
-      for(monster *m2: nonvirtual) if(m2!=m && m2->type != moBullet && m2->type != moArrowTrap) {
+      static vector<monster*> nearby;
+      for(monster *m2: near_index.find(nat*C0, sqdist_range(SCALE2*3), nearby)) if(m2!=m && m2->type != moBullet && m2->type != moArrowTrap) {
         double d = sqdist(m2->pat*C0, nat*C0);
         if(d < SCALE2*3 && m2->type == moPlayer) m->type = moRagingBull;
         }
@@ -1965,7 +2153,8 @@ void moveMonster(monster *m, int delta) {
       if(pc[pid]->isVirtual) continue;
       if(m->isVirtual) continue;
       bool okay = sqdist(pc[pid]->pat*C0, m->pat*C0) < 2 * SCALE2;
-      for(monster *m2: nonvirtual) {
+      static vector<monster*> nearby;
+      for(monster *m2: near_index.find(m->pat*C0, sqdist_range(2 * SCALE2), nearby)) {
         if(m2 != m && isWitch(m2->type) && sqdist(m2->pat*C0, m->pat*C0) < 2 * SCALE2)
           okay = false;
         }
@@ -2052,7 +2241,7 @@ void moveMonster(monster *m, int delta) {
       cell *cnext = c;
       for(int i=0; i<c->type; i++) {
         cell *c2 = c->move(i);
-        if(c2 && gmatrix.count(c2) && c2->pathdist < c->pathdist &&
+        if(c2 && gmatrix.count(c2) && path_distance(c2) < path_distance(c) &&
           passable_for(m->type, c2, c, P_CHAIN | P_ONPLAYER))
           cnext = c2;
         }
@@ -2144,7 +2333,8 @@ void moveMonster(monster *m, int delta) {
 
   monster* crashintomon = NULL;
   
-  if(!m->isVirtual && !inertia_based) for(monster *m2: nonvirtual) if(m2!=m && m2->type != moBullet && m2->type != moArrowTrap) {
+  static vector<monster*> nearby;
+  if(!m->isVirtual && !inertia_based) for(monster *m2: near_index.find(nat*C0, sqdist_range(SCALE2 * 0.1), nearby)) if(m2!=m && m2->type != moBullet && m2->type != moArrowTrap) {
     double d = sqdist(m2->pat*C0, nat*C0);
     if(d < SCALE2 * 0.1) crashintomon = m2;
     }
@@ -2264,12 +2454,13 @@ void moveMonster(monster *m, int delta) {
       cell *c3 = m->base->move(i);
       if(neighborId(c3, c2) != -1 && c3->wall == waFreshGrave && gmatrix.count(c3)) {
         bool monstersNear = false;
-        for(monster *m2: nonvirtual) {
+        static vector<monster*> nearby;
+        for(monster *m2: near_index.find(gmatrix[c3]*C0, sqdist_range(SCALE2 * .3), nearby))
           if(m2 != m && sqdist(m2->pat*C0, gmatrix[c3]*C0) < SCALE2 * .3)
             monstersNear = true;
+        for(monster *m2: near_index.find(gmatrix[c2]*C0, sqdist_range(SCALE2 * .3), nearby))
           if(m2 != m && sqdist(m2->pat*C0, gmatrix[c2]*C0) < SCALE2 * .3)
             monstersNear = true;
-          }
         if(!monstersNear) {
 
           monster* undead = new monster;
@@ -2428,13 +2619,9 @@ void moveMonster(monster *m, int delta) {
 void activateMonstersAt(cell *c) {
   pair<mit, mit> p = 
     monstersAt.equal_range(c);
-  for(mit it = p.first; it != p.second;) {
-    mit itplus = it;
-    itplus++;
+  for(mit it = p.first; it != p.second; it++)
     active.push_back(it->second);
-    monstersAt.erase(it);
-    it = itplus;
-    }
+  monstersAt.erase(c);
   if(c->monst && isMimic(c->monst)) c->monst = moNone;
   // mimics are awakened by awakenMimics
   if(c->monst && !isIvy(c) && !isWorm(c) && !isMutantIvy(c) && !isKraken(c->monst) && c->monst != moPrincess && c->monst != moHunterGuard) {
@@ -2541,6 +2728,7 @@ EX void turn(int delta) {
     else nonvirtual.push_back(m);
     exists[movegroup(m->type)] = true;
     }
+  near_index.build();
   
   for(monster *m: active) {
     
@@ -2573,14 +2761,14 @@ EX void turn(int delta) {
       onpath(c, isPlayerOn(c) ? 0 : 1);
 
     int qb = 0;
-    for(qb=0; qb < isize(pathq); qb++) {
-      cell *c = pathq[qb];
-      int d = c->pathdist;
+    for(qb=0; qb < isize(path_search.q); qb++) {
+      cell *c = path_search.q[qb];
+      int d = path_search.dist(c);
       if(d == PINFD-1) continue;
       for(int i=0; i<c->type; i++) {
         cell *c2 = c->move(i);
         // printf("i=%d cd=%d\n", i, c->move(i)->cpdist);
-        if(c2 && c2->pathdist == PINFD && gmatrix.count(c2) && 
+        if(c2 && !path_search.reached(c2) && gmatrix.count(c2) && 
           (passable_for(eMonster(t), c, c2, P_CHAIN | P_ONPLAYER) || c->wall == waThumperOn)) {
           onpath(c2, d+1);
           }
@@ -2714,6 +2902,8 @@ EX void turn(int delta) {
     delayed_safety = false;
     }
 
+  near_index.clear();
+
   // deactivate all monsters
   for(monster *m: active)
     if(m->dead && m->type != moPlayer) {
@@ -2728,6 +2918,7 @@ EX void turn(int delta) {
       }
     
   active.clear();
+  monstersAt.rebuild();
   }
 
 EX void recall() {
@@ -2860,14 +3051,10 @@ EX void addShmupHelp(string& out) {
 auto hooks = addHook(hooks_clearmemory, 0, shmup::clearMemory) +
   addHook(hooks_gamedata, 0, shmup::gamedata) +
   addHook(hooks_removecells, 0, [] () {
-    for(mit it = monstersAt.begin(); it != monstersAt.end();) {
-      if(is_cell_removed(it->first)) {
-        monstersAt.insert(make_pair(nullptr, it->second));
-        auto it0 = it; it++;
-        monstersAt.erase(it0);
-        }
-      else it++;
-      }
+    bool changed = false;
+    for(auto& p: monstersAt)
+      if(is_cell_removed(p.first)) p.first = nullptr, changed = true;
+    if(changed) monstersAt.rebuild(true);
     });
 
 EX void switch_shmup() { 
@@ -71,6 +71,10 @@
 #define CAP_THREAD (!ISMOBILE && !ISWEB)
 #endif
 
+#ifndef CAP_MMAP
+#define CAP_MMAP (!ISWINDOWS && !ISMOBILE && !ISWEB)
+#endif
+
 #ifndef CAP_ZLIB
 #define CAP_ZLIB 1
 #endif
@@ -185,6 +189,14 @@
 #define MAXMDIM 4
 #endif
 
+#ifndef CAP_SIMD
+#if MAXMDIM == 4 && defined(__SSE2__)
+#define CAP_SIMD 1
+#else
+#define CAP_SIMD 0
+#endif
+#endif
+
 #ifndef CAP_TEXTURE
 #define CAP_TEXTURE (CAP_GL && (CAP_PNG || CAP_SDL_IMG) && !ISMINI)
 #endif
@@ -456,6 +468,11 @@ typedef unsigned GLuint;
 
 #if CAP_VIDEO
 #include <sys/wait.h>
+#include <poll.h>
+#endif
+
+#if CAP_MMAP
+#include <sys/mman.h>
 #endif
 
 #if CAP_ZLIB
@@ -466,6 +483,10 @@ typedef unsigned GLuint;
 #include <gmpxx.h>
 #endif
 
+#if CAP_SIMD
+#include <immintrin.h>
+#endif
+
 #if CAP_THREAD
 #if OLD_MINGW
 #include "mingw.thread.h"
@@ -476,6 +497,7 @@ typedef unsigned GLuint;
 #include <mutex>
 #include <condition_variable>
 #endif
+#include <atomic>
 #endif
 
 #ifdef USE_UNORDERED_MAP
@@ -1606,7 +1606,8 @@ EX void finishAll() {
 
 
 auto cgm = addHook(hooks_clearmemory, 40, [] () {
-  pathq.clear();
+  path_search.stop();
+  graphical_search.stop();
   dcal.clear();
   clearshadow();
   for(int i=0; i<MAXPLAYER; i++) lastmountpos[i] = NULL;
@@ -1620,7 +1621,6 @@ auto cgm = addHook(hooks_clearmemory, 40, [] () {
   adj_memo.clear();
   }) + 
 addHook(hooks_gamedata, 0, [] (gamedata* gd) {
-  gd->store(pathq);
   gd->store(dcal);
   gd->store(recallCell);
   gd->store(butterflies);
@@ -1633,7 +1633,8 @@ addHook(hooks_gamedata, 0, [] (gamedata* gd) {
   gd->store(pd_from);
   gd->store(pd_range);
   gd->store(pathqm);
-  gd->store(reachedfrom);
+  gd->store(path_search);
+  gd->store(graphical_search);
   gd->store(gravity_state);
   gd->store(last_gravity_state);
   gd->store(shpos);
@@ -0,0 +1,272 @@
+// Hyperbolic Rogue -- thread pool
+// Copyright (C) 2011-2020 Zeno Rogue, see 'hyper.cpp' for details
+
+/** \file threads.cpp
+ *  \brief a persistent pool of worker threads, used by parallel_for, parallel_reduce and async_job
+ *
+ *  The workers are started on the first use and then wait for jobs, so that parallel computations
+ *  which run many times per second do not pay for creating threads. Each worker has its own queue
+ *  of jobs, and steals from the other queues when its own is empty. A thread waiting for its jobs
+ *  runs the pending jobs too, so parallel_for can be nested.
+ */
+
+#include "hyper.h"
+namespace hr {
+
+/** the number of threads (including the calling thread) parallel_for uses by default; 0 means the number of hardware threads
+ *
+ *  Using threads is opt-in: the default is 1, so parallel_for, parallel_reduce and the computations based on them
+ *  (e.g. the Kohonen best matching unit search and -sagpt in RogueViz) run on the calling thread only, unless
+ *  changed with -threads N (saved in the config as "threads"). Not every caller is safe in every geometry, e.g.,
+ *  the tables of Solv are loaded lazily.
+ */
+EX int number_of_threads = 1;
+
+#if HDR
+/** jobs submitted to the pool which can be waited for together, see submit_job and wait_for */
+struct job_group {
+  #if CAP_THREAD
+  std::atomic<int> left;
+  std::mutex error_lock;
+  /** the first exception thrown by one of the jobs; wait_for rethrows it */
+  std::exception_ptr error;
+  #else
+  int left;
+  #endif
+  job_group() : left(0) {}
+  bool done() { return left == 0; }
+  };
+#endif
+
+#if CAP_THREAD
+static const int MAX_WORKERS = 128;
+
+/** the queue of the current thread: 0 for the threads outside of the pool */
+thread_local int my_queue = 0;
+
+struct job_pool {
+  struct job { function<void()> f; job_group *group; };
+  struct job_queue { std::mutex lock; std::deque<job> jobs; };
+
+  /** queues[0] is not used, queues[i] belongs to the i-th worker */
+  job_queue queues[MAX_WORKERS+1];
+  /** running counts the jobs taken from the queues and not finished yet */
+  std::atomic<int> workers, pending, running;
+  std::mutex sleep_lock, start_lock;
+  std::condition_variable wake;
+  int next_queue;
+
+  job_pool() : workers(0), pending(0), running(0), next_queue(0) {}
+
+  bool take(int q, job& j, bool back) {
+    auto& jq = queues[q];
+    std::lock_guard<std::mutex> lk(jq.lock);
+    if(jq.jobs.empty()) return false;
+    if(back) j = std::move(jq.jobs.back()), jq.jobs.pop_back();
+    else j = std::move(jq.jobs.front()), jq.jobs.pop_front();
+    /* still under the queue lock, so that lock_all sees every job as either queued or running */
+    pending--; running++;
+    return true;
+    }
+
+  void lock_all() {
+    start_lock.lock(); sleep_lock.lock();
+    for(auto& q: queues) q.lock.lock();
+    }
+
+  void unlock_all() {
+    for(auto& q: queues) q.lock.unlock();
+    sleep_lock.unlock(); start_lock.unlock();
+    }
+
+  /** run one pending job: the last one from our own queue, or the oldest one stolen from another queue */
+  bool run_one() {
+    if(!pending) return false;
+    job j;
+    int n = workers;
+    bool found = my_queue && take(my_queue, j, true);
+    for(int k=1; !found && k<=n; k++) found = take((my_queue + k - 1) % n + 1, j, false);
+    if(!found) return false;
+    try { j.f(); }
+    catch(...) {
+      std::lock_guard<std::mutex> lk(j.group->error_lock);
+      if(!j.group->error) j.group->error = std::current_exception();
+      }
+    running--;
+    /* the group may be destroyed as soon as left reaches 0, so only the pool is used after that */
+    if(--j.group->left == 0) {
+      { std::lock_guard<std::mutex> lk(sleep_lock); }
+      wake.notify_all();
+      }
+    return true;
+    }
+
+  /** run the pending jobs until g is done, sleeping when there is nothing to run */
+  void wait_done(job_group& g) {
+    while(!g.done()) {
+      if(run_one()) continue;
+      std::unique_lock<std::mutex> lk(sleep_lock);
+      wake.wait(lk, [this, &g] { return g.done() || pending > 0; });
+      }
+    }
+
+  void submit(job_group& g, const function<void()>& f) {
+    g.left++;
+    int q = my_queue;
+    if(!q) { std::lock_guard<std::mutex> lk(start_lock); q = next_queue++ % workers + 1; }
+    { std::lock_guard<std::mutex> lk(queues[q].lock); queues[q].jobs.push_back(job{f, &g}); }
+    { std::lock_guard<std::mutex> lk(sleep_lock); pending++; }
+    wake.notify_one();
+    }
+
+  void work(int id) {
+    my_queue = id;
+    while(true) {
+      if(run_one()) continue;
+      std::unique_lock<std::mutex> lk(sleep_lock);
+      wake.wait(lk, [this] { return pending > 0; });
+      }
+    }
+
+  /** make sure that there are at least n workers */
+  void start(int n) {
+    if(workers >= n) return;
+    std::lock_guard<std::mutex> lk(start_lock);
+    n = min(n, MAX_WORKERS);
+    while(workers < n) {
+      int id = workers + 1;
+      std::thread(&job_pool::work, this, id).detach();
+      workers++;
+      }
+    }
+  };
+
+/** never destroyed, since the workers keep running until exit */
+job_pool *pool = new job_pool;
+#endif
+
+/** call before fork(): wait until no job of the pool is pending or running, and keep the pool locked
+ *  until pool_after_fork, so that the child does not inherit jobs in progress or locked mutexes */
+EX void pool_before_fork() {
+  #if CAP_THREAD
+  while(true) {
+    pool->lock_all();
+    if(!pool->pending && !pool->running) return;
+    pool->unlock_all();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  #endif
+  }
+
+/** call after fork(), in both processes; the workers do not exist in the child, so it gets a new pool,
+ *  which starts its own workers when needed */
+EX void pool_after_fork(bool child) {
+  #if CAP_THREAD
+  if(child) pool = new job_pool;
+  else pool->unlock_all();
+  #endif
+  }
+
+/** is the current thread one of the workers of the pool? */
+EX bool in_pool_worker() {
+  #if CAP_THREAD
+  return my_queue != 0;
+  #else
+  return false;
+  #endif
+  }
+
+/** the number of threads to use, based on number_of_threads */
+EX int thread_count() {
+  #if CAP_THREAD
+  if(number_of_threads > 0) return min(number_of_threads, MAX_WORKERS + 1);
+  static int hw = max<int>(std::thread::hardware_concurrency(), 1);
+  return min(hw, MAX_WORKERS + 1);
+  #else
+  return 1;
+  #endif
+  }
+
+/** run job in the pool, as a part of g; without threads, it is run immediately */
+EX void submit_job(job_group& g, const function<void()>& job) {
+  #if CAP_THREAD
+  pool->start(1);
+  pool->submit(g, job);
+  #else
+  job();
+  #endif
+  }
+
+/** wait until all the jobs in g are done, running the pending jobs meanwhile; then rethrow the exception thrown by a job, if any */
+EX void wait_for(job_group& g) {
+  #if CAP_THREAD
+  pool->wait_done(g);
+  if(g.error) {
+    auto e = g.error;
+    g.error = nullptr;
+    std::rethrow_exception(e);
+    }
+  #endif
+  }
+
+/** call f(0), ..., f(chunks-1), in parallel; f(0) is run by the calling thread */
+EX void parallel_chunks(int chunks, const function<void(int)>& f) {
+  #if CAP_THREAD
+  if(chunks > 1) {
+    pool->start(chunks - 1);
+    job_group g;
+    for(int k=1; k<chunks; k++) pool->submit(g, [&f, k] { f(k); });
+    /* the other chunks use f and g, so they must be done before f(0) can throw out of here */
+    try { f(0); }
+    catch(...) { pool->wait_done(g); throw; }
+    wait_for(g);
+    return;
+    }
+  #endif
+  for(int k=0; k<chunks; k++) f(k);
+  }
+
+/** call f(from, to) for the parts of [0,n), in parallel; chunks is the number of parts (0: thread_count()) */
+EX void parallel_for(int n, const function<void(int, int)>& f, int chunks IS(0)) {
+  if(!chunks) chunks = thread_count();
+  parallel_chunks(chunks, [&] (int k) { f(n*(long long)k/chunks, n*(long long)(k+1)/chunks); });
+  }
+
+#if HDR
+/** the result of async_job */
+template<class T> struct job_future {
+  shared_ptr<job_group> group;
+  shared_ptr<T> result;
+  bool ready() { return group->done(); }
+  T& get() { wait_for(*group); return *result; }
+  };
+
+/** compute f(from, to) for the parts of [0,n), and return the sum of the results */
+template<class T, class F> T parallel_reduce(int n, T zero, const F& f, int chunks = 0) {
+  if(!chunks) chunks = thread_count();
+  vector<T> results(chunks, zero);
+  parallel_chunks(chunks, [&] (int k) { results[k] = f(n*(long long)k/chunks, n*(long long)(k+1)/chunks); });
+  T res = zero;
+  for(auto& r: results) res += r;
+  return res;
+  }
+
+/** run f in the pool, and return its result as a job_future */
+template<class F> auto async_job(const F& f) -> job_future<decltype(f())> {
+  job_future<decltype(f())> fut;
+  fut.group = std::make_shared<job_group> ();
+  fut.result = std::make_shared<decltype(f())> ();
+  submit_job(*fut.group, [f, fut] { *fut.result = f(); });
+  return fut;
+  }
+#endif
+
+#if CAP_COMMANDLINE
+auto ah_threads = addHook(hooks_args, 100, [] {
+  using namespace arg;
+  if(argis("-threads")) { shift(); number_of_threads = argi(); return 0; }
+  else return 1;
+  });
+#endif
+
+}
@@ -124,6 +124,89 @@ EX bool appears(const string& haystack, const string& needle) {
   return simplify(haystack).find(simplify(needle)) != string::npos;
   }
 
+#if HDR
+/** \brief open addressing hash map, with the entries kept in the order of insertion
+ *
+ *  Used where tree lookups used to dominate, e.g. the coordinate maps of hrmap_crystal.
+ *  References to the values are invalidated by inserting or erasing entries; erasing
+ *  moves the last entry into the place of the erased one.
+ */
+template<class K, class V, class H> struct open_map {
+  vector<pair<K, V>> entries;
+  /** index into entries plus one, or 0 for an empty slot; the size is 0 or a power of two, at least twice the number of entries */
+  vector<int> table;
+
+  size_t size() const { return entries.size(); }
+  typename vector<pair<K, V>>::iterator begin() { return entries.begin(); }
+  typename vector<pair<K, V>>::iterator end() { return entries.end(); }
+
+  size_t locate(const K& k) const {
+    size_t mask = table.size() - 1;
+    size_t i = H()(k) & mask;
+    while(table[i] && !(entries[table[i]-1].first == k)) i = (i+1) & mask;
+    return i;
+    }
+
+  V* find(const K& k) {
+    if(table.empty()) return nullptr;
+    int id = table[locate(k)];
+    return id ? &entries[id-1].second : nullptr;
+    }
+
+  int count(const K& k) { return find(k) != nullptr; }
+
+  V& operator [] (const K& k) {
+    if(2 * (entries.size() + 1) > table.size()) grow();
+    int& id = table[locate(k)];
+    if(!id) {
+      entries.emplace_back(k, V());
+      id = isize(entries);
+      }
+    return entries[id-1].second;
+    }
+
+  void erase(const K& k) {
+    if(table.empty()) return;
+    size_t mask = table.size() - 1;
+    size_t i = locate(k);
+    int id = table[i];
+    if(!id) return;
+    /* backward shift deletion, so that no tombstones are needed */
+    table[i] = 0;
+    for(size_t j = (i+1) & mask; table[j]; j = (j+1) & mask) {
+      size_t h = H()(entries[table[j]-1].first) & mask;
+      if(((j - h) & mask) >= ((j - i) & mask)) table[i] = table[j], table[j] = 0, i = j;
+      }
+    int last = isize(entries);
+    if(id != last) {
+      table[locate(entries[last-1].first)] = id;
+      entries[id-1] = std::move(entries[last-1]);
+      }
+    entries.pop_back();
+    }
+
+  void grow() {
+    table.assign(max<size_t>(16, 2 * table.size()), 0);
+    for(int i=0; i<isize(entries); i++) table[locate(entries[i].first)] = i+1;
+    }
+
+  void clear() { entries.clear(); table.clear(); }
+  };
+
+inline size_t mix_hash(unsigned long long h) {
+  h *= 0x9E3779B97F4A7C15ull;
+  return size_t(h ^ (h >> 32));
+  }
+
+struct pointer_hash {
+  size_t operator() (const void *p) const { return mix_hash(reinterpret_cast<size_t>(p)); }
+  };
+
+struct integer_hash {
+  size_t operator() (long long k) const { return mix_hash(k); }
+  };
+#endif
+
 #if HDR
 struct hr_parse_exception : hr_exception {
   string s;
@@ -183,6 +266,39 @@ struct exp_parser {
     }
 
   };
+
+/** thrown by exp_compiler for the constructs which only exp_parser can evaluate */
+struct hr_uncompilable_exception : hr_parse_exception {
+  hr_uncompilable_exception(const string& z) : hr_parse_exception(z) {}
+  };
+
+/** a formula compiled by exp_compiler; the variables are read from the given slots (and let writes into them) */
+typedef std::function<cld(cld*)> compiled_formula;
+
+/** compiles a formula into a tree of closures, for formulas evaluated many times with different values of the variables */
+struct exp_compiler : exp_parser {
+  /** the variables visible in the current scope, and their slots */
+  vector<pair<string, int>> scope;
+  /** which slots are referenced by the formula; let adds new slots */
+  vector<bool> used;
+
+  exp_compiler(const vector<string>& names) {
+    for(auto& n: names) scope.emplace_back(n, isize(used)), used.push_back(false);
+    }
+
+  int find_slot(const string& name) {
+    for(int i=isize(scope)-1; i>=0; i--) if(scope[i].first == name) return scope[i].second;
+    return -1;
+    }
+
+  compiled_formula compile(int prio = 0);
+
+  compiled_formula compilepar() {
+    auto res = compile();
+    force_eat(")");
+    return res;
+    }
+  };
 #endif
 
 void exp_parser::skip_white() {
@@ -436,6 +552,144 @@ cld exp_parser::parse(int prio) {
   return res;
   }
 
+ld compiled_real(cld x) {
+  if(kz(imag(x))) throw hr_parse_exception("expected real number but " + lalign(-1, x) + " found");
+  return real(x);
+  }
+
+compiled_formula constant_formula(cld x) { return [x] (cld*) { return x; }; }
+
+/* this follows exp_parser::parse, including the order in which the subformulas are evaluated */
+compiled_formula exp_compiler::compile(int prio) {
+  compiled_formula res;
+  skip_white();
+
+  static const vector<pair<const char*, std::function<cld(cld)>>> unary = {
+    {"sin(", [] (cld x) { return sin(x); }},
+    {"cos(", [] (cld x) { return cos(x); }},
+    {"sinh(", [] (cld x) { return sinh(x); }},
+    {"cosh(", [] (cld x) { return cosh(x); }},
+    {"asin(", [] (cld x) { return asin(x); }},
+    {"acos(", [] (cld x) { return acos(x); }},
+    {"asinh(", [] (cld x) { return asinh(x); }},
+    {"acosh(", [] (cld x) { return acosh(x); }},
+    {"exp(", [] (cld x) { return exp(x); }},
+    {"sqrt(", [] (cld x) { return sqrt(x); }},
+    {"log(", [] (cld x) { return log(x); }},
+    {"tan(", [] (cld x) { return tan(x); }},
+    {"tanh(", [] (cld x) { return tanh(x); }},
+    {"atan(", [] (cld x) { return atan(x); }},
+    {"atanh(", [] (cld x) { return atanh(x); }},
+    {"abs(", [] (cld x) { return cld(abs(x)); }},
+    {"re(", [] (cld x) { return cld(real(x)); }},
+    {"im(", [] (cld x) { return cld(imag(x)); }},
+    {"conj(", [] (cld x) { return std::conj(x); }},
+    {"floor(", [] (cld x) { return cld(floor(compiled_real(x))); }},
+    {"frac(", [] (cld x) { return x - floor(compiled_real(x)); }},
+    };
+
+  for(auto& u: unary) if(eat(u.first)) {
+    auto f = compilepar();
+    auto g = u.second;
+    res = [f, g] (cld *v) { return g(f(v)); };
+    break;
+    }
+
+  int p_slot = find_slot("p");
+  auto get_p = [p_slot] (cld *v) { return p_slot >= 0 ? real(v[p_slot]) : 0; };
+
+  if(res) ;
+  else if(eat("to01(")) {
+    auto f = compilepar();
+    return [f] (cld *v) { return atan(f(v)) / ld(M_PI) + ld(0.5); };
+    }
+  else if(eat("edge(") || eat("edge_angles(") || eat("regradius(") || eat("arcmedge(") || eat("regangle(") || eat("test(") || eat("txp("))
+    throw hr_uncompilable_exception("not compiled: " + where());
+  else if(eat("ifp(")) {
+    auto cond = compile(0);
+    force_eat(",");
+    auto yes = compile(0);
+    force_eat(",");
+    auto no = compilepar();
+    res = [cond, yes, no] (cld *v) { cld c = cond(v), y = yes(v), n = no(v); return real(c) > 0 ? y : n; };
+    }
+  else if(eat("wallif(")) {
+    auto val0 = compile(0);
+    force_eat(",");
+    auto val1 = compilepar();
+    res = [val0, val1, get_p] (cld *v) { cld v0 = val0(v), v1 = val1(v); return get_p(v) >= 3.5 ? v0 : v1; };
+    }
+  else if(eat("rgb(")) {
+    auto val0 = compile(0);
+    force_eat(",");
+    auto val1 = compile(0);
+    force_eat(",");
+    auto val2 = compilepar();
+    res = [val0, val1, val2, get_p] (cld *v) {
+      cld v0 = val0(v), v1 = val1(v), v2 = val2(v);
+      switch(int(get_p(v) + .5)) {
+        case 1: return v0;
+        case 2: return v1;
+        case 3: return v2;
+        default: return cld(0);
+        }
+      };
+    }
+  else if(eat("let(")) {
+    string name = next_token();
+    force_eat("=");
+    auto val = compile(0);
+    force_eat(",");
+    int id = isize(used);
+    used.push_back(true);
+    scope.emplace_back(name, id);
+    auto body = compilepar();
+    scope.pop_back();
+    res = [id, val, body] (cld *v) { v[id] = val(v); return body(v); };
+    }
+  else if(next() == '(') at++, res = compilepar();
+  else {
+    string number = next_token();
+    int id = find_slot(number);
+    if(id >= 0) { used[id] = true; res = [id] (cld *v) { return v[id]; }; }
+    else if(params.count(number)) { ld *x = &params.at(number); res = [x] (cld*) { return cld(*x); }; }
+    else if(number == "e") res = constant_formula(exp(1));
+    else if(number == "i") res = constant_formula(cld(0, 1));
+    else if(number == "p" || number == "pi") res = constant_formula(M_PI);
+    else if(number == "" && next() == '-') { at++; auto f = compile(prio); res = [f] (cld *v) { return -f(v); }; }
+    else if(number == "") throw hr_parse_exception("number missing, " + where());
+    else if(number == "s") res = [] (cld*) { return cld(ticks / 1000.); };
+    else if(number == "ms") res = [] (cld*) { return cld(ticks); };
+    else if(number[0] == '0' && number[1] == 'x') res = constant_formula(strtoll(number.c_str()+2, NULL, 16));
+    else if(number == "mousex") res = [] (cld*) { return cld(mousex); };
+    else if(number == "deg") res = constant_formula(degree);
+    else if(number == "ultra_mirror_dist") res = [] (cld*) { return cld(cgi.ultra_mirror_dist); };
+    else if(number == "psl_steps") res = [] (cld*) { return cld(cgi.psl_steps); };
+    else if(number == "single_step") res = [] (cld*) { return cld(cgi.single_step); };
+    else if(number == "step") res = [] (cld*) { return cld(hdist0(tC0(currentmap->adj(cwt.at, 0)))); };
+    else if(number == "mousey") res = [] (cld*) { return cld(mousey); };
+    else if(number == "random") res = [] (cld*) { return cld(randd()); };
+    else if(number == "mousez") res = [] (cld*) { return cld(mousex - current_display->xcenter, mousey - current_display->ycenter) / cld(current_display->radius, 0); };
+    else if(number == "shot") res = [] (cld*) { return cld(inHighQual ? 1 : 0); };
+    else if(number[0] >= 'a' && number[0] <= 'z') throw hr_parse_exception("unknown value: " + number);
+    else { std::stringstream ss; cld x = 0; ss << number; ss >> x; res = constant_formula(x); }
+    }
+  while(true) {
+    skip_white();
+    #if CAP_ANIMATIONS
+    if(next() == '.' && next(1) == '.' && prio == 0) throw hr_uncompilable_exception("not compiled: " + where());
+    #endif
+    auto l = res;
+    if(next() == '+' && prio <= 10) { at++; auto r = compile(20); res = [l, r] (cld *v) { cld a = l(v); return a + r(v); }; }
+    else if(next() == '-' && prio <= 10) { at++; auto r = compile(20); res = [l, r] (cld *v) { cld a = l(v); return a - r(v); }; }
+    else if(next() == '*' && prio <= 20) { at++; auto r = compile(30); res = [l, r] (cld *v) { cld a = l(v); return a * r(v); }; }
+    else if(next() == '/' && prio <= 20) { at++; auto r = compile(30); res = [l, r] (cld *v) { cld a = l(v); return a / r(v); }; }
+    else if(next() == '^') { at++; auto r = compile(40); res = [l, r] (cld *v) { cld a = l(v); return pow(a, r(v)); }; }
+    else break;
+    }
+  return res;
+  }
+
 EX ld parseld(const string& s) {
   exp_parser ep;
   ep.s = s;